@@ -0,0 +1,421 @@
+// micro-benchmarks for the hot kernels of NN-cms.
+//
+// usage: NN-bench.x [--reps N] [--warmup N] [--threads N] [--channel-mesh N] [--output file.json]
+//
+// every kernel is timed over a fixed set of representative (p', p, x) points taken from the
+// momentum and angular meshes of "inifile-cms.ini". one sample is the wall time of a batch of
+// calls, divided by the batch size; the statistics (min, median, mean, MAD, p90) are taken over
+// the repetitions after the warmup batches are discarded. results are written as JSON.
+
+#include "../src/kernel_output.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+
+namespace bench
+{
+    struct options
+    {
+        size_t reps = 30;
+        size_t warmup = 5;
+        size_t threads = 1;
+        size_t channel_mesh = 24; // mesh points used for the full write_dat_single_channel benchmark.
+        std::string output = "bench-results.json";
+    };
+
+    struct statistics
+    {
+        std::string name;
+        std::string group;
+        size_t calls_per_sample;
+        size_t samples;
+        double min_ns, median_ns, mean_ns, mad_ns, p90_ns;
+    };
+
+    // a representative (p', p, x) point.
+    struct point
+    {
+        double p_final;
+        double p_initial;
+        double x;
+    };
+
+    // sink for the benchmarked results, so that nothing is optimized away.
+    volatile double sink = 0.0;
+
+    double median_of(std::vector<double> v)
+    {
+        std::sort(v.begin(), v.end());
+        size_t n = v.size();
+        return (n % 2 == 1) ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+    }
+
+    statistics summarize(const std::string &group, const std::string &name, size_t calls_per_sample, const std::vector<double> &samples_ns)
+    {
+        statistics st;
+        st.group = group;
+        st.name = name;
+        st.calls_per_sample = calls_per_sample;
+        st.samples = samples_ns.size();
+        auto sorted = samples_ns;
+        std::sort(sorted.begin(), sorted.end());
+        st.min_ns = sorted.front();
+        st.median_ns = median_of(sorted);
+        double sum = 0.0;
+        for (auto v : sorted)
+        {
+            sum += v;
+        }
+        st.mean_ns = sum / sorted.size();
+        std::vector<double> deviations;
+        for (auto v : sorted)
+        {
+            deviations.push_back(std::fabs(v - st.median_ns));
+        }
+        st.mad_ns = median_of(deviations);
+        st.p90_ns = sorted[std::min(sorted.size() - 1, static_cast<size_t>(0.9 * sorted.size()))];
+        return st;
+    }
+
+    // time "batch" (which performs "calls" kernel evaluations) with warmup and repetitions.
+    statistics run(const std::string &group, const std::string &name, size_t calls, const options &opts, const std::function<void()> &batch)
+    {
+        for (size_t i = 0; i < opts.warmup; i = i + 1)
+        {
+            batch();
+        }
+        std::vector<double> samples_ns;
+        for (size_t i = 0; i < opts.reps; i = i + 1)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            batch();
+            auto t1 = std::chrono::steady_clock::now();
+            samples_ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count() / calls);
+        }
+        auto st = summarize(group, name, calls, samples_ns);
+        std::cout << std::left << std::setw(16) << group << std::setw(40) << name << std::right << std::fixed << std::setprecision(1) << std::setw(14) << st.median_ns
+                  << " ns  (mad " << st.mad_ns << ")" << std::endl;
+        return st;
+    }
+
+    // representative points: low/mid/high momenta, near-diagonal and far off-diagonal, several angles.
+    std::vector<point> representative_points(const NN::NN_configs &configs)
+    {
+        std::vector<point> points;
+        size_t n = configs.mesh_points_number;
+        std::vector<size_t> mom_idx = {0, n / 8, n / 4, n / 2, (3 * n) / 4, n - 1};
+        std::vector<size_t> ang_idx = {0, configs.angular_mesh_number / 3, configs.angular_mesh_number / 2, configs.angular_mesh_number - 1};
+        for (auto i : mom_idx)
+        {
+            for (auto k : mom_idx)
+            {
+                for (auto a : ang_idx)
+                {
+                    points.push_back({configs.momentum_mesh_points[i], configs.momentum_mesh_points[k], configs.angular_mesh_points[a]});
+                }
+            }
+        }
+        return points;
+    }
+
+    // channels [l', l, s, j] of a class for given j, empty if the class does not exist for this j.
+    std::vector<std::vector<int>> class_channels(const std::string &cls, int j)
+    {
+        if (cls == "singlet")
+        {
+            return {{j, j, 0, j}};
+        }
+        if (cls == "triplet-uncoupled")
+        {
+            return (j == 0) ? std::vector<std::vector<int>>{{1, 1, 1, 0}} : std::vector<std::vector<int>>{{j, j, 1, j}};
+        }
+        if (j == 0)
+        {
+            return {};
+        }
+        if (cls == "coupled-mm")
+        {
+            return {{j - 1, j - 1, 1, j}};
+        }
+        if (cls == "coupled-mp")
+        {
+            return {{j - 1, j + 1, 1, j}};
+        }
+        if (cls == "coupled-pm")
+        {
+            return {{j + 1, j - 1, 1, j}};
+        }
+        if (cls == "coupled-pp")
+        {
+            return {{j + 1, j + 1, 1, j}};
+        }
+        return {};
+    }
+
+    void write_json(const std::string &fname, const options &opts, const NN::NN_configs &configs, const std::vector<statistics> &results)
+    {
+        std::ofstream fp(fname);
+        if (!fp.is_open())
+        {
+            std::cerr << "failed to open benchmark output: " << fname << std::endl;
+            exit(-1);
+        }
+        auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        char date_str[100];
+        std::strftime(date_str, sizeof(date_str), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+        fp << "{\n";
+        fp << "  \"date\": \"" << date_str << "\",\n";
+        fp << "  \"reps\": " << opts.reps << ",\n";
+        fp << "  \"warmup\": " << opts.warmup << ",\n";
+        fp << "  \"threads\": " << opts.threads << ",\n";
+        fp << "  \"mesh_points_number\": " << configs.mesh_points_number << ",\n";
+        fp << "  \"angular_mesh_number\": " << configs.angular_mesh_number << ",\n";
+        fp << "  \"channel_mesh\": " << opts.channel_mesh << ",\n";
+        fp << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i = i + 1)
+        {
+            const auto &r = results[i];
+            fp << std::setprecision(6) << std::defaultfloat;
+            fp << "    {\"group\": \"" << r.group << "\", \"name\": \"" << r.name << "\", \"calls_per_sample\": " << r.calls_per_sample << ", \"samples\": " << r.samples
+               << ", \"min_ns\": " << r.min_ns << ", \"median_ns\": " << r.median_ns << ", \"mean_ns\": " << r.mean_ns << ", \"mad_ns\": " << r.mad_ns
+               << ", \"p90_ns\": " << r.p90_ns << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        fp << "  ]\n";
+        fp << "}\n";
+        fp.close();
+    }
+
+    options parse_options(int argc, char **argv)
+    {
+        options opts;
+        for (int i = 1; i < argc; i = i + 1)
+        {
+            std::string arg = argv[i];
+            if (i + 1 >= argc)
+            {
+                std::cerr << "missing value for option: " << arg << std::endl;
+                exit(-1);
+            }
+            std::string value = argv[++i];
+            if (arg == "--reps")
+            {
+                opts.reps = std::stoul(value);
+            }
+            else if (arg == "--warmup")
+            {
+                opts.warmup = std::stoul(value);
+            }
+            else if (arg == "--threads")
+            {
+                opts.threads = std::stoul(value);
+            }
+            else if (arg == "--channel-mesh")
+            {
+                opts.channel_mesh = std::stoul(value);
+            }
+            else if (arg == "--output")
+            {
+                opts.output = value;
+            }
+            else
+            {
+                std::cerr << "unknown option: " << arg << std::endl;
+                exit(-1);
+            }
+        }
+        if (opts.reps == 0)
+        {
+            opts.reps = 1;
+        }
+        return opts;
+    }
+
+} // namespace bench
+
+int main(int argc, char **argv)
+{
+    auto opts = bench::parse_options(argc, argv);
+
+    auto ini = inifile_system::inifile("inifile-cms.ini");
+    if (!ini.good())
+    {
+        std::cerr << ini.error() << std::endl;
+        exit(-1);
+    }
+    auto configs = NN::NN_configs(ini);
+    omp_set_num_threads(opts.threads);
+
+    std::cout << "---- NN-cms benchmarks: reps = " << opts.reps << ", warmup = " << opts.warmup << ", threads = " << opts.threads << "\n\n";
+
+    auto points = bench::representative_points(configs);
+    const size_t npts = points.size();
+    std::vector<bench::statistics> results;
+
+    //---- gauss-legendre rule generation, without the cache.
+    for (int order : {24, 48, 1000, 4000})
+    {
+        results.push_back(bench::run("quadrature", "gauss_legendre_rule_n" + std::to_string(order), 1, opts, [&]()
+                                     {
+            GaussLegendreRule rule(order, -1.0, 1.0);
+            bench::sink = rule.getWeight(0); }));
+    }
+
+    //---- regulator and loop functions.
+    results.push_back(bench::run("regulator", "regulator_function", npts, opts, [&]()
+                                 {
+        double acc = 0.0;
+        for (const auto &pt : points)
+        {
+            acc += interaction_aPWD::regulator_function(pt.p_initial, pt.p_final, configs.n_reg_one_pion_exchange, configs);
+        }
+        bench::sink = acc; }));
+
+    std::vector<double> q_values;
+    for (const auto &pt : points)
+    {
+        q_values.push_back(std::sqrt(pt.p_final * pt.p_final + pt.p_initial * pt.p_initial - 2.0 * pt.p_final * pt.p_initial * pt.x) + 1e-3);
+    }
+    results.push_back(bench::run("loop", "loop_function_L", npts, opts, [&]()
+                                 {
+        double acc = 0.0;
+        for (auto q : q_values)
+        {
+            acc += interaction_aPWD::loop_function_L(q, configs);
+        }
+        bench::sink = acc; }));
+    results.push_back(bench::run("loop", "loop_function_A", npts, opts, [&]()
+                                 {
+        double acc = 0.0;
+        for (auto q : q_values)
+        {
+            acc += interaction_aPWD::loop_function_A(q, configs);
+        }
+        bench::sink = acc; }));
+
+    //---- pion-exchange terms (np 1S0 and 3S1 cover both isospin branches).
+    std::vector<std::vector<int>> pe_channels = {{0, 0, 0, 0, 0}, {0, 0, 1, 1, 0}, {0, 0, 0, 0, 1}};
+    results.push_back(bench::run("pion-exchange", "potential_one_pion_exchange", npts * pe_channels.size(), opts, [&]()
+                                 {
+        double acc = 0.0;
+        for (const auto &ch : pe_channels)
+        {
+            for (const auto &pt : points)
+            {
+                acc += interaction_part_pion_exchange::potential_one_pion_exchange(ch[0], ch[1], ch[2], ch[3], ch[4], pt.p_final, pt.p_initial, pt.x, configs)[5];
+            }
+        }
+        bench::sink = acc; }));
+    results.push_back(bench::run("pion-exchange", "potential_two_pion_exchange_nlo", npts * pe_channels.size(), opts, [&]()
+                                 {
+        double acc = 0.0;
+        for (const auto &ch : pe_channels)
+        {
+            for (const auto &pt : points)
+            {
+                acc += interaction_part_pion_exchange::potential_two_pion_exchange_nlo(ch[0], ch[1], ch[2], ch[3], ch[4], pt.p_final, pt.p_initial, pt.x, configs)[0];
+            }
+        }
+        bench::sink = acc; }));
+    results.push_back(bench::run("pion-exchange", "potential_two_pion_exchange_n2lo", npts * pe_channels.size(), opts, [&]()
+                                 {
+        double acc = 0.0;
+        for (const auto &ch : pe_channels)
+        {
+            for (const auto &pt : points)
+            {
+                acc += interaction_part_pion_exchange::potential_two_pion_exchange_n2lo(ch[0], ch[1], ch[2], ch[3], ch[4], pt.p_final, pt.p_initial, pt.x, configs)[0];
+            }
+        }
+        bench::sink = acc; }));
+    auto configs_n3lo = configs;
+    configs_n3lo.set_two_pion_exchange_n3lo_table();
+    results.push_back(bench::run("pion-exchange", "potential_two_pion_exchange_n3lo", npts * pe_channels.size(), opts, [&]()
+                                 {
+        double acc = 0.0;
+        for (const auto &ch : pe_channels)
+        {
+            for (const auto &pt : points)
+            {
+                acc += interaction_part_pion_exchange::potential_two_pion_exchange_n3lo(ch[0], ch[1], ch[2], ch[3], ch[4], pt.p_final, pt.p_initial, pt.x, configs_n3lo)[0];
+            }
+        }
+        bench::sink = acc; }));
+
+    //---- automated partial-wave projection, per channel class and J.
+    const std::vector<double> f_unit = {1.0, 0.5, 0.25, 0.125, 0.0625, 0.03125};
+    const std::vector<std::string> classes = {"singlet", "triplet-uncoupled", "coupled-mm", "coupled-mp", "coupled-pm", "coupled-pp"};
+    for (const auto &cls : classes)
+    {
+        for (int j = 0; j <= 10; j = j + 1)
+        {
+            for (const auto &ch : bench::class_channels(cls, j))
+            {
+                std::ostringstream name;
+                name << "potential_auto/" << cls << "/J=" << j;
+                results.push_back(bench::run("aPWD", name.str(), npts, opts, [&]()
+                                             {
+                    double acc = 0.0;
+                    for (const auto &pt : points)
+                    {
+                        acc += interaction_aPWD::potential_auto(ch[0], ch[1], ch[2], ch[3], pt.p_final, pt.p_initial, pt.x, f_unit);
+                    }
+                    bench::sink = acc; }));
+            }
+        }
+    }
+
+    //---- full matrix element, all contact and pion-exchange terms with angular integration.
+    std::vector<std::vector<int>> element_channels = {{0, 0, 0, 0, 0}, {0, 2, 1, 1, 0}, {2, 2, 0, 2, 1}, {5, 5, 1, 6, -1}};
+    for (const auto &ch : element_channels)
+    {
+        std::ostringstream name;
+        name << "potential_chiral/" << ch[0] << "-" << ch[1] << "-" << ch[2] << "-" << ch[3] << "-" << ch[4];
+        const size_t stride = 4; // the angle does not enter here, skip duplicated (p', p) pairs.
+        results.push_back(bench::run("element", name.str(), npts / stride, opts, [&]()
+                                     {
+            double acc = 0.0;
+            for (size_t i = 0; i < npts; i = i + stride)
+            {
+                acc += interaction_all::potential_chiral(ch[0], ch[1], ch[2], ch[3], ch[4], points[i].p_final, points[i].p_initial, configs);
+            }
+            bench::sink = acc; }));
+    }
+
+    //---- full channel: evaluation, text formatting and binary packing on a reduced mesh.
+    {
+        auto channel_configs = configs;
+        size_t n = std::min(opts.channel_mesh, configs.mesh_points_number);
+        channel_configs.mesh_points_number = n;
+        channel_configs.momentum_mesh_points.clear();
+        channel_configs.momentum_mesh_weights.clear();
+        for (size_t i = 0; i < n; i = i + 1)
+        {
+            size_t k = (i * configs.mesh_points_number) / n;
+            channel_configs.momentum_mesh_points.push_back(configs.momentum_mesh_points[k]);
+            channel_configs.momentum_mesh_weights.push_back(configs.momentum_mesh_weights[k]);
+        }
+        channel_configs.result_dir = "bench-tmp/";
+        channel_configs.result_name = "bench";
+        std::filesystem::create_directories(channel_configs.result_dir);
+
+        bench::options channel_opts = opts;
+        channel_opts.reps = std::max<size_t>(3, opts.reps / 10);
+        channel_opts.warmup = std::min<size_t>(1, opts.warmup);
+        std::vector<int> channel = {0, 0, 0, 0, 0};
+        std::ostringstream name;
+        name << "write_dat_single_channel/1S0-np/N=" << n;
+        auto *cout_buf = std::cout.rdbuf(nullptr);
+        auto st = bench::run("channel", name.str(), n * n, channel_opts, [&]()
+                             { kernel_output::write_dat_single_channel(channel, channel_configs); });
+        std::cout.rdbuf(cout_buf);
+        std::cout.clear();
+        std::cout << std::left << std::setw(16) << st.group << std::setw(40) << st.name << std::right << std::fixed << std::setprecision(1) << std::setw(14) << st.median_ns
+                  << " ns  (mad " << st.mad_ns << ") per element" << std::endl;
+        results.push_back(st);
+        std::filesystem::remove_all(channel_configs.result_dir);
+    }
+
+    bench::write_json(opts.output, opts, configs, results);
+    std::cout << "\n---- benchmark results written in: " << opts.output << std::endl;
+    return 0;
+}
@@ -0,0 +1,166 @@
+#pragma once
+#ifndef ANGULAR_QUADRATURE_HPP
+#define ANGULAR_QUADRATURE_HPP
+
+#include "interaction_all.hpp"
+#include "lib_define.hpp"
+
+// per-channel choice of the angular gauss-legendre order, switched on by "angular_mode = adaptive".
+// the momentum mesh is cut into blocks of "angular_block" x "angular_block" points. in every block the element
+// with the sharpest angular integrand and the one at the lowest momenta are evaluated with increasing orders
+// of "angular_orders" until two successive orders agree within "angular_tolerance" relative to
+// max(|V|, angular_floor * channel scale), the lower of the two is then used for the whole block.
+namespace angular_quadrature
+{
+    struct plan
+    {
+        size_t n = 0;                     // momentum mesh points.
+        size_t block = 1;                 // momentum points per block.
+        size_t blocks = 0;                // blocks per direction.
+        std::vector<size_t> ladder_index; // index into configs.angular_orders, per block.
+        size_t probe_evaluations = 0;     // angular integrand evaluations spent on choosing the orders.
+        size_t element_evaluations = 0;   // angular integrand evaluations of the matrix elements.
+        size_t unconverged_blocks = 0;    // blocks that did not converge up to the highest order.
+
+        size_t rule(size_t idx_mom_bra, size_t idx_mom_ket) const { return ladder_index[(idx_mom_bra / block) * blocks + idx_mom_ket / block]; }
+    };
+
+    // the position of the nearest singularity x0 = (p'^2 + p^2 + m^2) / (2 p' p) > 1 of the one-pion-exchange
+    // propagator in x = cos(theta) sets the convergence rate of the angular rule, smaller is harder.
+    double singularity_distance(double p_final, double p_initial, const NN::NN_configs &configs)
+    {
+        double m = configs.mass_pion_neutral;
+        return (p_final * p_final + p_initial * p_initial + m * m) / (2.0 * p_final * p_initial);
+    }
+
+    // choose the angular order of every block of one channel [l', l, s, j, tz].
+    plan make_plan(const std::vector<int> &this_channel, const NN::NN_configs &configs)
+    {
+        int l_final = this_channel[0];
+        int l_initial = this_channel[1];
+        int s = this_channel[2];
+        int j = this_channel[3];
+        int tz = this_channel[4];
+        const auto &points = configs.momentum_mesh_points;
+
+        plan pl;
+        pl.n = configs.mesh_points_number;
+        pl.block = configs.angular_block;
+        pl.blocks = (pl.n + pl.block - 1) / pl.block;
+        pl.ladder_index.assign(pl.blocks * pl.blocks, configs.angular_orders.size() - 1);
+
+        // blocks on the diagonal first, they set the scale of the channel for the absolute floor.
+        std::vector<size_t> block_order;
+        for (size_t b = 0; b < pl.blocks; b = b + 1)
+        {
+            block_order.push_back(b * pl.blocks + b);
+        }
+        for (size_t b = 0; b < pl.blocks * pl.blocks; b = b + 1)
+        {
+            if (b / pl.blocks != b % pl.blocks)
+            {
+                block_order.push_back(b);
+            }
+        }
+
+        double scale = 0.0;
+        for (auto b : block_order)
+        {
+            // probe the element of the block closest to the singularity, and the one at the lowest momenta
+            // which is the least suppressed by the regulators.
+            size_t bra_begin = (b / pl.blocks) * pl.block;
+            size_t ket_begin = (b % pl.blocks) * pl.block;
+            size_t bra_end = std::min(pl.n, bra_begin + pl.block);
+            size_t ket_end = std::min(pl.n, ket_begin + pl.block);
+            size_t probe_bra = bra_begin, probe_ket = ket_begin;
+            double x0 = singularity_distance(points[probe_bra], points[probe_ket], configs);
+            for (size_t idx_mom_bra = bra_begin; idx_mom_bra < bra_end; idx_mom_bra = idx_mom_bra + 1)
+            {
+                for (size_t idx_mom_ket = ket_begin; idx_mom_ket < ket_end; idx_mom_ket = idx_mom_ket + 1)
+                {
+                    double x0_element = singularity_distance(points[idx_mom_bra], points[idx_mom_ket], configs);
+                    if (x0_element < x0)
+                    {
+                        x0 = x0_element;
+                        probe_bra = idx_mom_bra;
+                        probe_ket = idx_mom_ket;
+                    }
+                }
+            }
+            std::vector<std::pair<size_t, size_t>> probes = {{probe_bra, probe_ket}};
+            if (probe_bra != bra_begin || probe_ket != ket_begin)
+            {
+                probes.push_back({bra_begin, ket_begin});
+            }
+
+            size_t order_index = 0;
+            for (const auto &probe : probes)
+            {
+                // two successive orders agree: the lower one is accurate to about their difference.
+                double p_final = points[probe.first];
+                double p_initial = points[probe.second];
+                double v_lower = interaction_all::potential_element(l_final, l_initial, s, j, tz, p_final, p_initial, configs, configs.angular_ladder_points[0],
+                                                                    configs.angular_ladder_weights[0]);
+                pl.probe_evaluations += configs.angular_orders[0];
+                size_t k = 0;
+                for (; k + 1 < configs.angular_orders.size(); k = k + 1)
+                {
+                    double v_higher = interaction_all::potential_element(l_final, l_initial, s, j, tz, p_final, p_initial, configs, configs.angular_ladder_points[k + 1],
+                                                                         configs.angular_ladder_weights[k + 1]);
+                    pl.probe_evaluations += configs.angular_orders[k + 1];
+                    double floor = configs.angular_floor * scale;
+                    bool converged = std::fabs(v_higher - v_lower) <= configs.angular_tolerance * std::max(std::fabs(v_higher), floor);
+                    v_lower = v_higher;
+                    if (converged)
+                    {
+                        break;
+                    }
+                }
+                if (k + 1 == configs.angular_orders.size())
+                {
+                    pl.unconverged_blocks = pl.unconverged_blocks + 1;
+                }
+                scale = std::max(scale, std::fabs(v_lower));
+                order_index = std::max(order_index, std::min(k, configs.angular_orders.size() - 1));
+            }
+            pl.ladder_index[b] = order_index;
+
+            pl.element_evaluations += (bra_end - bra_begin) * (ket_end - ket_begin) * configs.angular_orders[order_index];
+        }
+        return pl;
+    }
+
+    // one line summary of a plan.
+    void print_plan(const plan &pl, const NN::NN_configs &configs)
+    {
+        auto minmax = std::minmax_element(pl.ladder_index.begin(), pl.ladder_index.end());
+        std::cout << "angular orders: " << configs.angular_orders[*minmax.first] << " - " << configs.angular_orders[*minmax.second]
+                  << ", integrand evaluations: " << pl.element_evaluations + pl.probe_evaluations << " (fixed: " << pl.n * pl.n * configs.angular_mesh_number << ")";
+        if (pl.unconverged_blocks > 0)
+        {
+            std::cout << ", " << pl.unconverged_blocks << " blocks not converged at " << configs.angular_orders.back() << " points";
+        }
+        std::cout << std::endl;
+    }
+
+    // full matrix of one channel, row-major, with the angular orders of "pl".
+    std::vector<double> potential_matrix(const std::vector<int> &this_channel, const NN::NN_configs &configs, const plan &pl)
+    {
+        size_t n = configs.mesh_points_number;
+        std::vector<double> v(n * n);
+        for (size_t idx_mom_bra = 0; idx_mom_bra < n; idx_mom_bra = idx_mom_bra + 1)
+        {
+            for (size_t idx_mom_ket = 0; idx_mom_ket < n; idx_mom_ket = idx_mom_ket + 1)
+            {
+                size_t k = pl.rule(idx_mom_bra, idx_mom_ket);
+                v[idx_mom_bra * n + idx_mom_ket] = interaction_all::potential_element(this_channel[0], this_channel[1], this_channel[2], this_channel[3], this_channel[4],
+                                                                                      configs.momentum_mesh_points[idx_mom_bra], configs.momentum_mesh_points[idx_mom_ket], configs,
+                                                                                      configs.angular_ladder_points[k], configs.angular_ladder_weights[k]);
+            }
+        }
+        return v;
+    }
+
+} // namespace angular_quadrature
+
+#endif // ANGULAR_QUADRATURE_HPP
@@ -11,59 +11,58 @@
 namespace basic_math
 {
 
+    // gauss-legendre rule with "degree" points in [a,b], nodes and weights together.
+    // rules are computed once and cached, the reference stays valid.
+    const GaussLegendre::Rule &gauss_legendre_rule(size_t degree, double a = -1.0, double b = 1.0)
+    {
+        return GaussLegendre::getRule(degree, a, b);
+    }
+
     // calculates gauss-legendre nodes in [-1,+1].
     std::vector<double> gauss_legendre_nodes(size_t degree)
     {
-        std::vector<double> nodes;
-
-        GaussLegendreRule gaussLegendre(degree, -1.0, 1.0);
-        for (size_t i = 0; i < degree; i = i + 1)
-        {
-            double node_i = gaussLegendre.getNode(i);
-            nodes.push_back(node_i);
-        }
-        return nodes;
+        return gauss_legendre_rule(degree).nodes;
     }
 
     // calculates gauss-legendre weights in [-1,+1].
     std::vector<double> gauss_legendre_weights(size_t degree)
     {
-        std::vector<double> weights;
-
-        GaussLegendreRule gaussLegendre(degree, -1.0, 1.0);
-        for (size_t i = 0; i < degree; i = i + 1)
-        {
-            double weight_i = gaussLegendre.getWeight(i);
-            weights.push_back(weight_i);
-        }
-        return weights;
+        return gauss_legendre_rule(degree).weights;
     }
 
     // calculates gauss-legendre nodes in [a,b].
     std::vector<double> gauss_legendre_nodes_interval(double a, double b, size_t degree)
     {
-        std::vector<double> nodes_interval;
-        auto nodes = gauss_legendre_nodes(degree);
-        for (size_t idx = 0; idx < nodes.size(); idx++)
-        {
-            double xi = nodes[idx];
-            nodes_interval.push_back((b - a) / 2.0 * xi + (b + a) / 2.0);
-        }
-
-        return nodes_interval;
+        return gauss_legendre_rule(degree, a, b).nodes;
     }
 
     // calculates gauss-legendre weights in [a,b].
     std::vector<double> gauss_legendre_weights_interval(double a, double b, size_t degree)
     {
-        std::vector<double> weights_interval;
-        auto weights = gauss_legendre_weights(degree);
-        for (size_t idx = 0; idx < weights.size(); idx++)
+        return gauss_legendre_rule(degree, a, b).weights;
+    }
+
+    // compensated (neumaier) sum of "terms" in their order, the result does not depend on how they were computed.
+    template <typename T>
+    T neumaier_sum(const std::vector<T> &terms)
+    {
+        using std::abs;
+        T sum = T(0.0);
+        T compensation = T(0.0);
+        for (const auto &term : terms)
         {
-            double wi = weights[idx];
-            weights_interval.push_back((b - a) / 2.0 * wi);
+            T t = sum + term;
+            if (abs(sum) >= abs(term))
+            {
+                compensation += (sum - t) + term;
+            }
+            else
+            {
+                compensation += (term - t) + sum;
+            }
+            sum = t;
         }
-        return weights_interval;
+        return sum + compensation;
     }
 
 } // namespace basic_math
@@ -0,0 +1,272 @@
+#pragma once
+#ifndef BOUND_STATE_HPP
+#define BOUND_STATE_HPP
+
+#include "kernel_output.hpp"
+#include "linear_algebra.hpp"
+#include "lib_define.hpp"
+#include <numeric>
+
+// "NN-cms.x --deuteron": the deuteron in the coupled 3S1-3D1 channel (j = 1, tz = 0), from the mesh kernels in memory.
+// with phi_a(p_i) = sqrt(w_i) p_i psi_a(p_i) the schroedinger equation on the mesh is the symmetric 2n x 2n problem
+//     sum_bk [ p_i^2 / 2mu delta_ab delta_ik + sqrt(w_i) p_i V_ab(p_i, p_k) p_k sqrt(w_k) ] phi_b(p_k) = E phi_a(p_i),
+// in the normalization of the lippmann-schwinger equation of phase_shifts.hpp. the bound state is found by inverse
+// iteration, first with the fixed shift "energy_guess" to select the state, then with the shift set to the rayleigh
+// quotient, a newton step on the energy that converges cubically.
+namespace bound_state
+{
+    struct settings
+    {
+        double energy_guess;      // MeV, start of the energy search.
+        double tolerance;         // relative residual |H phi - E phi| / |E|.
+        bool write_wave_function; // write result_name-deuteron-wave-function.txt.
+    };
+
+    // optional [deuteron] section.
+    settings read_settings(const inifile_system::inifile &ini)
+    {
+        settings st{-2.2, 1e-12, false};
+        if (ini.has_section("deuteron"))
+        {
+            auto sec = ini.section("deuteron");
+            st.energy_guess = sec.has_key("energy_guess") ? sec.get_double("energy_guess") : st.energy_guess;
+            st.tolerance = sec.has_key("tolerance") ? sec.get_double("tolerance") : st.tolerance;
+            st.write_wave_function = sec.has_key("write_wave_function") ? sec.get_bool("write_wave_function") : st.write_wave_function;
+        }
+        if (st.energy_guess >= 0.0 || st.tolerance <= 0.0)
+        {
+            std::cerr << "the deuteron needs energy_guess < 0 and tolerance > 0" << std::endl;
+            exit(-1);
+        }
+        return st;
+    }
+
+    struct result
+    {
+        bool bound = false;
+        double energy = 0.0;                    // MeV.
+        size_t iterations = 0;
+        double residual = 0.0;
+        std::vector<double> psi_s, psi_d;       // psi_a(p_i) in MeV^-3/2, int dp p^2 (psi_s^2 + psi_d^2) = 1.
+        double d_state_probability = 0.0;
+        double asymptotic_s = 0.0;              // A_S in fm^-1/2.
+        double asymptotic_ratio = 0.0;          // eta = A_D / A_S.
+    };
+
+    // 2n x 2n hamiltonian of the blocks [--, -+, +-, ++] on the mesh, row-major.
+    std::vector<double> hamiltonian(const std::vector<std::vector<double>> &kernels, double mu2, const NN::NN_configs &configs)
+    {
+        size_t n = configs.mesh_points_number;
+        const auto &p = configs.momentum_mesh_points;
+        const auto &w = configs.momentum_mesh_weights;
+        std::vector<double> f(n);
+        for (size_t i = 0; i < n; i = i + 1)
+        {
+            f[i] = std::sqrt(w[i]) * p[i];
+        }
+        std::vector<double> h(4 * n * n);
+        for (size_t a = 0; a < 2; a = a + 1)
+        {
+            for (size_t b = 0; b < 2; b = b + 1)
+            {
+                const auto &v = kernels[a * 2 + b];
+                for (size_t i = 0; i < n; i = i + 1)
+                {
+                    double *row = h.data() + (a * n + i) * 2 * n + b * n;
+                    for (size_t k = 0; k < n; k = k + 1)
+                    {
+                        row[k] = f[i] * v[i * n + k] * f[k];
+                    }
+                }
+            }
+        }
+        for (size_t i = 0; i < 2 * n; i = i + 1)
+        {
+            h[i * 2 * n + i] += p[i % n] * p[i % n] / mu2;
+        }
+        return h;
+    }
+
+    // lowest bound state near "energy_guess" of the hamiltonian "h" of dimension "dim", normalized eigenvector in "phi".
+    result inverse_iteration(const std::vector<double> &h, size_t dim, const settings &st, std::vector<double> &phi)
+    {
+        const size_t fixed_steps = 3, max_steps = 50;
+        result res;
+        phi.assign(dim, 1.0 / std::sqrt(double(dim)));
+        double shift = st.energy_guess;
+        std::vector<double> a(dim * dim), h_phi(dim);
+        std::vector<size_t> pivot;
+        for (size_t it = 1; it <= max_steps; it = it + 1)
+        {
+            a = h;
+            for (size_t i = 0; i < dim; i = i + 1)
+            {
+                a[i * dim + i] -= shift;
+            }
+            if (!linear_algebra::lu_factorize(a, dim, pivot))
+            {
+                // the shift is an eigenvalue to working precision.
+                res.iterations = it;
+                break;
+            }
+            linear_algebra::lu_solve(a, dim, pivot, phi);
+            double norm = std::sqrt(std::inner_product(phi.begin(), phi.end(), phi.begin(), 0.0));
+            for (auto &x : phi)
+            {
+                x /= norm;
+            }
+
+            // rayleigh quotient and residual.
+            double energy = 0.0, residual = 0.0;
+            for (size_t i = 0; i < dim; i = i + 1)
+            {
+                h_phi[i] = std::inner_product(h.begin() + i * dim, h.begin() + (i + 1) * dim, phi.begin(), 0.0);
+                energy += phi[i] * h_phi[i];
+            }
+            for (size_t i = 0; i < dim; i = i + 1)
+            {
+                residual += (h_phi[i] - energy * phi[i]) * (h_phi[i] - energy * phi[i]);
+            }
+            res.energy = energy;
+            res.residual = std::sqrt(residual) / std::abs(energy);
+            res.iterations = it;
+            if (res.residual < st.tolerance)
+            {
+                break;
+            }
+            if (it >= fixed_steps)
+            {
+                shift = energy;
+            }
+        }
+        res.bound = res.energy < 0.0 && res.residual < std::max(st.tolerance, 1e-8);
+        return res;
+    }
+
+    // spherical bessel functions j0 and j2.
+    double bessel_j(int l, double x)
+    {
+        if (x < 1e-3)
+        {
+            return l == 0 ? 1.0 - x * x / 6.0 : x * x / 15.0;
+        }
+        double s = std::sin(x), c = std::cos(x);
+        return l == 0 ? s / x : (3.0 / (x * x * x) - 1.0 / x) * s - 3.0 * c / (x * x);
+    }
+
+    // radial wave function u(r) or w(r) = r sqrt(2/pi) int dp p^2 j_l(pr) psi_l(p) in fm^-1/2, r in fm.
+    // the phase i^l of the plane-wave expansion is part of the partial-wave kernels, so w(r) has the sign of eta > 0.
+    double radial_wave_function(int l, double r, const std::vector<double> &psi, const NN::NN_configs &configs)
+    {
+        const auto &p = configs.momentum_mesh_points;
+        const auto &w = configs.momentum_mesh_weights;
+        double sum = 0.0;
+        for (size_t k = 0; k < p.size(); k = k + 1)
+        {
+            sum += w[k] * p[k] * p[k] * bessel_j(l, p[k] * r / constants::hbarc) * psi[k];
+        }
+        // psi in MeV^-3/2, dp p^2 in MeV^3, and r in fm: MeV^3/2 = hbarc^3/2 fm^-3/2.
+        return r * std::sqrt(2.0 / constants::pi) * sum / std::pow(constants::hbarc, 1.5);
+    }
+
+    // A_S and eta from u(r) -> A_S exp(-gamma r) and w(r) -> A_D exp(-gamma r) (1 + 3/(gamma r) + 3/(gamma r)^2),
+    // averaged over r in [10, 14] fm, where the potential has died off and the mesh still resolves the tail.
+    void asymptotic_normalization(result &res, double mu2, const NN::NN_configs &configs)
+    {
+        double gamma = std::sqrt(-mu2 * res.energy) / constants::hbarc;
+        double a_s = 0.0, eta = 0.0;
+        const size_t samples = 9;
+        for (size_t idx = 0; idx < samples; idx = idx + 1)
+        {
+            double r = 10.0 + 0.5 * idx;
+            double x = gamma * r;
+            double u = radial_wave_function(0, r, res.psi_s, configs);
+            double w = radial_wave_function(2, r, res.psi_d, configs);
+            a_s += u * std::exp(x) / samples;
+            eta += w / u / (1.0 + 3.0 / x + 3.0 / (x * x)) / samples;
+        }
+        res.asymptotic_s = a_s;
+        res.asymptotic_ratio = eta;
+    }
+
+    // solve the deuteron from the four np kernels [--, -+, +-, ++] of j = 1 on the momentum mesh.
+    result solve(const std::vector<std::vector<double>> &kernels, const NN::NN_configs &configs, const settings &st)
+    {
+        size_t n = configs.mesh_points_number;
+        double mu2 = 2.0 * configs.mass_proton * configs.mass_neutron / (configs.mass_proton + configs.mass_neutron);
+        auto h = hamiltonian(kernels, mu2, configs);
+        std::vector<double> phi;
+        auto res = inverse_iteration(h, 2 * n, st, phi);
+        if (!res.bound)
+        {
+            return res;
+        }
+
+        const auto &p = configs.momentum_mesh_points;
+        const auto &w = configs.momentum_mesh_weights;
+        res.psi_s.resize(n);
+        res.psi_d.resize(n);
+        double sign = 0.0;
+        for (size_t i = 0; i < n; i = i + 1)
+        {
+            sign += w[i] * p[i] * p[i] * phi[i];
+        }
+        sign = sign < 0.0 ? -1.0 : 1.0; // positive S-wave at short distances.
+        for (size_t i = 0; i < n; i = i + 1)
+        {
+            res.psi_s[i] = sign * phi[i] / (std::sqrt(w[i]) * p[i]);
+            res.psi_d[i] = sign * phi[n + i] / (std::sqrt(w[i]) * p[i]);
+            res.d_state_probability += phi[n + i] * phi[n + i];
+        }
+        asymptotic_normalization(res, mu2, configs);
+        return res;
+    }
+
+    // compute the j = 1 np kernels, solve and print the deuteron.
+    int run(const inifile_system::inifile &ini, const NN::NN_configs &configs)
+    {
+        auto st = read_settings(ini);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::vector<double>> kernels;
+        for (const auto &channel : std::vector<std::vector<int>>{{0, 0, 1, 1, 0}, {0, 2, 1, 1, 0}, {2, 0, 1, 1, 0}, {2, 2, 1, 1, 0}})
+        {
+            kernels.push_back(kernel_output::compute_channel(channel, configs));
+        }
+        auto kernels_end = std::chrono::steady_clock::now();
+        auto res = solve(kernels, configs, st);
+        auto end = std::chrono::steady_clock::now();
+
+        std::cout.precision(4);
+        std::cout << "---- deuteron of " << configs.result_name << ", " << configs.mesh_points_number << " mesh points\n"
+                  << "     mesh kernels: " << std::chrono::duration<double>(kernels_end - start).count() << " s, bound state: "
+                  << std::chrono::duration<double>(end - kernels_end).count() * 1e3 << " ms, " << res.iterations << " iterations\n";
+        if (!res.bound)
+        {
+            std::cerr << "no bound state found near energy_guess = " << st.energy_guess << " MeV (last energy " << res.energy << " MeV, residual " << res.residual << ")" << std::endl;
+            return 1;
+        }
+        std::cout.precision(10);
+        std::cout << "     binding energy   E_B = " << -res.energy << " MeV\n"
+                  << "     D-state prob.    P_D = " << 100.0 * res.d_state_probability << " %\n"
+                  << "     asymptotic S     A_S = " << res.asymptotic_s << " fm^-1/2\n"
+                  << "     asymptotic D/S   eta = " << res.asymptotic_ratio << std::endl;
+
+        if (st.write_wave_function)
+        {
+            std::string fname = configs.result_dir + configs.result_name + "-deuteron-wave-function.txt";
+            std::ofstream fp(fname);
+            fp << "# deuteron wave function of " << configs.result_name << ", E = " << std::setprecision(12) << res.energy << " MeV\n"
+               << "# p[MeV] weight[MeV] psi_S(p)[MeV^-3/2] psi_D(p)[MeV^-3/2], int dp p^2 (psi_S^2 + psi_D^2) = 1\n";
+            fp << std::scientific << std::setprecision(17);
+            for (size_t i = 0; i < configs.mesh_points_number; i = i + 1)
+            {
+                fp << configs.momentum_mesh_points[i] << " " << configs.momentum_mesh_weights[i] << " " << res.psi_s[i] << " " << res.psi_d[i] << "\n";
+            }
+            std::cout << "     wave function written in: " << fname << std::endl;
+        }
+        return 0;
+    }
+
+} // namespace bound_state
+
+#endif // BOUND_STATE_HPP
@@ -5,13 +5,32 @@
 #include "inifile.hpp"
 #include "basic_math.hpp"
 #include "constants.hpp"
+#include "dual.hpp"
+#include "momentum_mesh.hpp"
+#include "spectral_tables.hpp"
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <sstream>
+#include <algorithm>
+#include <stdexcept>
 
 namespace NN
 {
+    // invalid settings, thrown by NN_configs so that a long-running caller (--serve) can answer and go on.
+    struct config_error : std::runtime_error
+    {
+        using std::runtime_error::runtime_error;
+    };
+
+    // throw config_error with the streamed "parts" as message.
+    template <typename... Parts>
+    [[noreturn]] void config_fail(const Parts &...parts)
+    {
+        std::ostringstream oss;
+        (oss << ... << parts);
+        throw config_error(oss.str());
+    }
 
     struct NN_configs
     {
@@ -24,8 +43,21 @@ namespace NN
         double C_1s0, C_3s1, C_1p1, C_3p0, C_3p1, C_3sd1, C_3p2;
         double Lambda, Lambda_tilde;
 
+        // chiral order of the interaction: "lo", "nlo", "n2lo" (default) or "n3lo", which adds the subleading
+        // two-pion exchange with c2 and the d-bar combinations. chiral_order_index counts from 0 for lo.
+        std::string chiral_order;
+        size_t chiral_order_index;
+        double c2;
+        double d1_plus_d2, d3, d5, d14_minus_d15;
+
         size_t n_reg_Ctilde_1s0, n_reg_Ctilde_3s1, n_reg_C_1s0, n_reg_C_3s1, n_reg_C_1p1, n_reg_C_3p0, n_reg_C_3p1, n_reg_C_3sd1, n_reg_C_3p2;
-        size_t n_reg_one_pion_exchange, n_reg_two_pion_exchange_nlo, n_reg_two_pion_exchange_n2lo;
+        size_t n_reg_one_pion_exchange, n_reg_two_pion_exchange_nlo, n_reg_two_pion_exchange_n2lo, n_reg_two_pion_exchange_n3lo;
+
+        // tabulated two-loop two-pion exchange of the n3lo order, see spectral_tables.hpp.
+        spectral_tables::table two_pion_exchange_n3lo_table;
+
+        // yukawa expansion of the two-pion exchange for "tpe_projection = spectral", see spectral_tables.hpp.
+        spectral_tables::yukawa_expansion two_pion_exchange_expansion;
 
         // ***** meson masses section ****
         double mass_pion_charged;
@@ -49,12 +81,76 @@ namespace NN
         std::vector<double> angular_mesh_points;
         std::vector<double> angular_mesh_weights;
 
+        // angular quadrature mode: "fixed" (default) uses the rule above everywhere, "adaptive" picks an order
+        // of "angular_orders" per channel and momentum block, see angular_quadrature.hpp.
+        std::string angular_mode;
+        double angular_tolerance;
+        double angular_floor;
+        size_t angular_block;
+        std::vector<size_t> angular_orders;
+        std::vector<std::vector<double>> angular_ladder_points;
+        std::vector<std::vector<double>> angular_ladder_weights;
+
+        // partial-wave projection of the one-pion exchange: "quadrature" (default) with the angular rule like the other
+        // pion-exchange terms, or "analytic" in closed form with legendre functions of the second kind, see ope_projection.hpp.
+        std::string ope_projection;
+
+        // partial-wave projection of the two-pion exchange: "quadrature" (default) with the angular rule, or "spectral" as
+        // sums of yukawa projections over "tpe_spectral_points" spectral nodes per loop function, see tpe_projection.hpp.
+        std::string tpe_projection;
+        size_t tpe_spectral_points;
+
+        // regulator screening (optional, default off): blocks of "screening_block" x "screening_block" momentum points whose
+        // bound is below "screening_tolerance" relative to the largest element are written as zeros, see screening.hpp.
+        bool screening;
+        double screening_tolerance;
+        size_t screening_block;
+
         std::vector<std::vector<int>> partial_waves;
 
+        // scalar type of the evaluation: "double" (default) or "float".
+        std::string precision;
+
+        // openmp threads of a run (optional, default 16).
+        size_t thread_number;
+
         // ***** output section *****
         std::string result_dir;
         std::string result_name;
 
+        // kernels written under result_name that are derived from the interaction rather than the interaction itself,
+        // e.g. "srg 2.00 fm^-1" or "derivative dga" (empty for the interaction), set by the modes that write them.
+        std::string derivation;
+
+        // write a JSON run report with per-stage timings (optional, default off).
+        bool run_report;
+
+        // value type of the binary kernel files: "double" (default, .bin) or "float" (.f32.bin).
+        std::string binary_precision;
+
+        // name of the POSIX shared-memory segment the kernel set is published in, e.g. "/nncms-n2lo" (optional, default none).
+        std::string shm_name;
+
+        // layout of the kernel files: coupled channels as four n x n files ("separate", default) or one 2n x 2n
+        // block ("block"), "row" (default) or "column" major, and optionally multiplied by p' p sqrt(w' w).
+        std::string coupled_layout;
+        std::string matrix_order;
+        bool weight_folding;
+
+        // kernel files as truncated low-rank factors ("lowrank", see kernel_lowrank.hpp) instead of full matrices ("none",
+        // default), dropping the singular values below "compression_tolerance" times the largest one.
+        std::string compression;
+        double compression_tolerance;
+
+        // write the kernels in row tiles with positioned writes, for large meshes (optional, default off),
+        // holding at most "memory_budget_mb" MB of tiles at a time.
+        bool tiled_output;
+        double memory_budget_mb;
+
+        // parameters the kernels are also differentiated with respect to, e.g. "derivatives = ga, fpi, lambda" (optional,
+        // default none). every derivative is written like the kernels, under the result_name "result_name-d<parameter>".
+        std::vector<dual_numbers::parameter> derivatives;
+
         // constructor
         NN_configs(const inifile_system::inifile &ini);
 
@@ -64,6 +160,15 @@ namespace NN
         // read momentum mesh from file
         void read_momentum_mesh(std::string file_momentum_mesh);
 
+        // set up the momentum mesh from the optional [momentum-mesh] section, or read it from file
+        void set_momentum_mesh(const inifile_system::inifile &ini);
+
+        // tabulate the n3lo two-loop terms for every momentum transfer |p' - p| of the mesh
+        void set_two_pion_exchange_n3lo_table();
+
+        // expand the two-pion exchange in yukawa terms, after the n3lo table
+        void set_two_pion_exchange_expansion();
+
         // read partial-waves from file
         void read_uncoupled_pw_channels(std::string file_uncoupled_pw);
         void read_coupled_pw_channels(std::string file_coupled_pw);
@@ -114,6 +219,21 @@ namespace NN
         n_reg_two_pion_exchange_nlo = sec.get_int("n_reg_two_pion_exchange_nlo");
         n_reg_two_pion_exchange_n2lo = sec.get_int("n_reg_two_pion_exchange_n2lo");
 
+        chiral_order = sec.has_key("chiral_order") ? sec.get_string("chiral_order") : "n2lo";
+        const std::vector<std::string> chiral_orders = {"lo", "nlo", "n2lo", "n3lo"};
+        auto order_pos = std::find(chiral_orders.begin(), chiral_orders.end(), chiral_order);
+        if (order_pos == chiral_orders.end())
+        {
+            config_fail("unknown chiral_order: ", chiral_order, " (lo, nlo, n2lo or n3lo)");
+        }
+        chiral_order_index = order_pos - chiral_orders.begin();
+        c2 = (sec.has_key("c2") ? sec.get_double("c2") : 0.0) * 1e-3;
+        d1_plus_d2 = (sec.has_key("d1_plus_d2") ? sec.get_double("d1_plus_d2") : 0.0) * 1e-6;
+        d3 = (sec.has_key("d3") ? sec.get_double("d3") : 0.0) * 1e-6;
+        d5 = (sec.has_key("d5") ? sec.get_double("d5") : 0.0) * 1e-6;
+        d14_minus_d15 = (sec.has_key("d14_minus_d15") ? sec.get_double("d14_minus_d15") : 0.0) * 1e-6;
+        n_reg_two_pion_exchange_n3lo = sec.has_key("n_reg_two_pion_exchange_n3lo") ? sec.get_int("n_reg_two_pion_exchange_n3lo") : n_reg_two_pion_exchange_n2lo;
+
         // ***** meson masses section ****
         sec = ini.section("meson-masses");
         mass_pion_charged = sec.get_double("mass_pion_charged");
@@ -129,14 +249,87 @@ namespace NN
         // ***** numerical parameters section ****
         sec = ini.section("numerical-parameters");
         angular_mesh_number = sec.get_int("angular_mesh_number");
+        precision = sec.has_key("precision") ? sec.get_string("precision") : "double";
+        if (precision != "double" && precision != "float")
+        {
+            config_fail("unknown precision: ", precision, " (double or float)");
+        }
+        int64_t threads = sec.has_key("threads") ? sec.get_int("threads") : 16;
+        if (threads < 1)
+        {
+            config_fail("threads must be positive: ", threads);
+        }
+        thread_number = threads;
 
         // set up angular mesh.
-        angular_mesh_points = basic_math::gauss_legendre_nodes(angular_mesh_number);
-        angular_mesh_weights = basic_math::gauss_legendre_weights(angular_mesh_number);
+        const auto &angular_rule = basic_math::gauss_legendre_rule(angular_mesh_number);
+        angular_mesh_points = angular_rule.nodes;
+        angular_mesh_weights = angular_rule.weights;
 
-        // read momentum mesh.
-        std::string file_momentum_mesh = "table_momentum_mesh.txt";
-        read_momentum_mesh(file_momentum_mesh);
+        // set up the ladder of angular rules of the adaptive mode.
+        angular_mode = sec.has_key("angular_mode") ? sec.get_string("angular_mode") : "fixed";
+        if (angular_mode != "fixed" && angular_mode != "adaptive")
+        {
+            config_fail("unknown angular_mode: ", angular_mode, " (fixed or adaptive)");
+        }
+        angular_tolerance = sec.has_key("angular_tolerance") ? sec.get_double("angular_tolerance") : 1e-9;
+        angular_floor = sec.has_key("angular_floor") ? sec.get_double("angular_floor") : 1e-6;
+        angular_block = sec.has_key("angular_block") ? sec.get_int("angular_block") : 8;
+        angular_orders = {8, 12, 16, 20, 24, 32, 40, 48, 64};
+        if (sec.has_key("angular_orders"))
+        {
+            angular_orders.clear();
+            std::istringstream iss(sec.get_string("angular_orders"));
+            std::string order;
+            while (std::getline(iss, order, ','))
+            {
+                angular_orders.push_back(std::stoul(order));
+            }
+        }
+        if (angular_block == 0 || angular_orders.size() < 2 || !std::is_sorted(angular_orders.begin(), angular_orders.end()))
+        {
+            config_fail("adaptive angular quadrature needs angular_block > 0 and at least two increasing angular_orders");
+        }
+        for (auto order : angular_orders)
+        {
+            const auto &rule = basic_math::gauss_legendre_rule(order);
+            angular_ladder_points.push_back(rule.nodes);
+            angular_ladder_weights.push_back(rule.weights);
+        }
+
+        ope_projection = sec.has_key("ope_projection") ? sec.get_string("ope_projection") : "quadrature";
+        if (ope_projection != "quadrature" && ope_projection != "analytic")
+        {
+            config_fail("unknown ope_projection: ", ope_projection, " (quadrature or analytic)");
+        }
+        tpe_projection = sec.has_key("tpe_projection") ? sec.get_string("tpe_projection") : "quadrature";
+        int64_t spectral_points = sec.has_key("tpe_spectral_points") ? sec.get_int("tpe_spectral_points") : 32;
+        if ((tpe_projection != "quadrature" && tpe_projection != "spectral") || spectral_points < 1)
+        {
+            config_fail("unknown tpe_projection: ", tpe_projection, " (quadrature or spectral, with tpe_spectral_points > 0)");
+        }
+        tpe_spectral_points = spectral_points;
+        screening = sec.has_key("screening") ? sec.get_bool("screening") : false;
+        screening_tolerance = sec.has_key("screening_tolerance") ? sec.get_double("screening_tolerance") : 1e-15;
+        int64_t block = sec.has_key("screening_block") ? sec.get_int("screening_block") : 8;
+        if (screening_tolerance < 0.0 || block < 1)
+        {
+            config_fail("screening needs screening_tolerance >= 0 and screening_block > 0");
+        }
+        screening_block = block;
+
+        // set up momentum mesh.
+        set_momentum_mesh(ini);
+
+        // tabulate the n3lo two-loop terms.
+        if (chiral_order == "n3lo")
+        {
+            set_two_pion_exchange_n3lo_table();
+        }
+        if (tpe_projection == "spectral")
+        {
+            set_two_pion_exchange_expansion();
+        }
 
         // read partial-waves.
         std::string file_uncoupled_pw = "table_uncoupled_channels.txt";
@@ -152,6 +345,60 @@ namespace NN
         {
             result_dir += "/";
         }
+        run_report = sec.has_key("run_report") ? sec.get_bool("run_report") : false;
+        binary_precision = sec.has_key("binary_precision") ? sec.get_string("binary_precision") : "double";
+        if (binary_precision != "double" && binary_precision != "float")
+        {
+            config_fail("unknown binary_precision: ", binary_precision, " (double or float)");
+        }
+        shm_name = sec.has_key("shm_name") ? sec.get_string("shm_name") : "";
+        if (!shm_name.empty() && (shm_name[0] != '/' || shm_name.find('/', 1) != std::string::npos))
+        {
+            config_fail("shm_name must start with '/' and contain no other '/': ", shm_name);
+        }
+        coupled_layout = sec.has_key("coupled_layout") ? sec.get_string("coupled_layout") : "separate";
+        matrix_order = sec.has_key("matrix_order") ? sec.get_string("matrix_order") : "row";
+        weight_folding = sec.has_key("weight_folding") ? sec.get_bool("weight_folding") : false;
+        if ((coupled_layout != "separate" && coupled_layout != "block") || (matrix_order != "row" && matrix_order != "column"))
+        {
+            config_fail("unknown kernel layout: coupled_layout = ", coupled_layout, " (separate or block), matrix_order = ", matrix_order, " (row or column)");
+        }
+        compression = sec.has_key("compression") ? sec.get_string("compression") : "none";
+        compression_tolerance = sec.has_key("compression_tolerance") ? sec.get_double("compression_tolerance") : 1e-10;
+        if ((compression != "none" && compression != "lowrank") || compression_tolerance <= 0.0 || compression_tolerance >= 1.0)
+        {
+            config_fail("unknown compression: ", compression, " (none or lowrank) or compression_tolerance not in (0, 1)");
+        }
+        tiled_output = sec.has_key("tiled_output") ? sec.get_bool("tiled_output") : false;
+        memory_budget_mb = sec.has_key("memory_budget_mb") ? sec.get_double("memory_budget_mb") : 1024.0;
+        if (tiled_output && (!shm_name.empty() || memory_budget_mb <= 0.0 || compression != "none"))
+        {
+            config_fail("tiled_output needs memory_budget_mb > 0 and cannot publish in shared memory (shm_name) or compress the kernels");
+        }
+        if (sec.has_key("derivatives"))
+        {
+            std::istringstream iss(sec.get_string("derivatives"));
+            std::string value;
+            while (std::getline(iss, value, ','))
+            {
+                value.erase(std::remove(value.begin(), value.end(), ' '), value.end());
+                auto pos = std::find(dual_numbers::parameter_names.begin(), dual_numbers::parameter_names.end(), value);
+                if (pos == dual_numbers::parameter_names.end())
+                {
+                    config_fail("unknown derivative parameter: ", value, " (ga, fpi, mpi_charged, mpi_neutral, mpi_averaged, lambda or lambda_tilde)");
+                }
+                auto id = dual_numbers::parameter(pos - dual_numbers::parameter_names.begin());
+                if (std::find(derivatives.begin(), derivatives.end(), id) == derivatives.end())
+                {
+                    derivatives.push_back(id);
+                }
+            }
+        }
+        // the n3lo two-loop terms come from spectral tables of fixed doubles, which carry no derivatives.
+        if (!derivatives.empty() && (precision != "double" || tiled_output || !shm_name.empty() || tpe_projection == "spectral" || chiral_order_index >= 3))
+        {
+            config_fail("derivatives need precision = double and cannot be combined with tiled_output, shm_name, tpe_projection = spectral or chiral_order = n3lo");
+        }
     };
 
     std::string file_stem(const std::string &file)
@@ -199,6 +446,96 @@ namespace NN
         file.close();
     }
 
+    void NN_configs::set_momentum_mesh(const inifile_system::inifile &ini)
+    {
+        if (!ini.has_section("momentum-mesh"))
+        {
+            read_momentum_mesh("table_momentum_mesh.txt");
+            return;
+        }
+        auto sec = ini.section("momentum-mesh");
+        std::string mesh_type = sec.has_key("mesh_type") ? sec.get_string("mesh_type") : "file";
+        if (mesh_type == "file")
+        {
+            read_momentum_mesh(sec.has_key("mesh_file") ? sec.get_string("mesh_file") : "table_momentum_mesh.txt");
+            return;
+        }
+
+        // upper end of the mesh, "auto" takes the momentum where the slowest regulator has dropped to p_max_tolerance.
+        double p_max;
+        std::string p_max_value = sec.has_key("p_max") ? sec.get_string("p_max") : "auto";
+        if (p_max_value == "auto")
+        {
+            size_t n_min = std::min({n_reg_Ctilde_1s0, n_reg_Ctilde_3s1, n_reg_C_1s0, n_reg_C_3s1, n_reg_C_1p1, n_reg_C_3p0, n_reg_C_3p1, n_reg_C_3sd1, n_reg_C_3p2,
+                                     n_reg_one_pion_exchange, n_reg_two_pion_exchange_nlo, n_reg_two_pion_exchange_n2lo, n_reg_two_pion_exchange_n3lo});
+            double tolerance = sec.has_key("p_max_tolerance") ? sec.get_double("p_max_tolerance") : 1e-12;
+            p_max = momentum_mesh::auto_p_max(Lambda, n_min, tolerance);
+        }
+        else
+        {
+            p_max = std::stod(p_max_value);
+        }
+
+        momentum_mesh::mesh m;
+        size_t n = sec.has_key("mesh_points") ? sec.get_int("mesh_points") : 100;
+        double c = sec.has_key("mesh_scale") ? sec.get_double("mesh_scale") : Lambda;
+        if (mesh_type == "linear")
+        {
+            m = momentum_mesh::linear(n, 0.0, p_max);
+        }
+        else if (mesh_type == "tangent")
+        {
+            m = momentum_mesh::tangent(n, c, p_max);
+        }
+        else if (mesh_type == "hyperbolic")
+        {
+            m = momentum_mesh::hyperbolic(n, c, p_max);
+        }
+        else if (mesh_type == "segments")
+        {
+            // "segment_bounds = 0, 400, 800" and "segment_points = 40, 30", the last bound may be "p_max".
+            std::vector<double> bounds;
+            std::vector<size_t> counts;
+            std::istringstream iss_bounds(sec.get_string("segment_bounds"));
+            std::string value;
+            while (std::getline(iss_bounds, value, ','))
+            {
+                value.erase(std::remove(value.begin(), value.end(), ' '), value.end());
+                bounds.push_back(value == "p_max" ? p_max : std::stod(value));
+            }
+            std::istringstream iss_counts(sec.get_string("segment_points"));
+            while (std::getline(iss_counts, value, ','))
+            {
+                counts.push_back(std::stoul(value));
+            }
+            if (bounds.size() != counts.size() + 1 || !std::is_sorted(bounds.begin(), bounds.end()))
+            {
+                config_fail("segment_bounds needs one more increasing value than segment_points");
+            }
+            m = momentum_mesh::segments(bounds, counts);
+        }
+        else
+        {
+            config_fail("unknown mesh_type: ", mesh_type, " (file, linear, tangent, hyperbolic or segments)");
+        }
+        momentum_mesh_points = m.points;
+        momentum_mesh_weights = m.weights;
+        mesh_points_number = momentum_mesh_points.size();
+    }
+
+    void NN_configs::set_two_pion_exchange_n3lo_table()
+    {
+        spectral_tables::parameters par = {axial_current_coupling_constant, pion_decay_constant, mass_pion_averaged, Lambda_tilde, d1_plus_d2, d3, d5, d14_minus_d15};
+        double q_max = 2.0 * *std::max_element(momentum_mesh_points.begin(), momentum_mesh_points.end());
+        two_pion_exchange_n3lo_table = spectral_tables::build(par, q_max, 2048, 96);
+    }
+
+    void NN_configs::set_two_pion_exchange_expansion()
+    {
+        spectral_tables::parameters par = {axial_current_coupling_constant, pion_decay_constant, mass_pion_averaged, Lambda_tilde, d1_plus_d2, d3, d5, d14_minus_d15};
+        two_pion_exchange_expansion = spectral_tables::build_yukawa_expansion(par, {c1, c2, c3, c4}, int(chiral_order_index), tpe_spectral_points, two_pion_exchange_n3lo_table);
+    }
+
     void NN_configs::read_uncoupled_pw_channels(std::string file_uncoupled_pw)
     {
         std::ifstream file(file_uncoupled_pw);
@@ -215,9 +552,11 @@ namespace NN
         int l, s, j, tz;
         std::vector<int> temp;
         std::istringstream iss(line);
-        iss >> l >> s >> j >> tz;
-        temp = {l, l, s, j, tz};
-        partial_waves.push_back(temp);
+        if (iss >> l >> s >> j >> tz) // the table may be empty.
+        {
+            temp = {l, l, s, j, tz};
+            partial_waves.push_back(temp);
+        }
         while (file >> l >> s >> j >> tz)
         {
             temp = {l, l, s, j, tz};
@@ -242,15 +581,17 @@ namespace NN
         int j, tz;
         std::vector<int> temp_mm, temp_mp, temp_pm, temp_pp;
         std::istringstream iss(line);
-        iss >> j >> tz;
-        temp_mm = {j - 1, j - 1, 1, j, tz};
-        temp_mp = {j - 1, j + 1, 1, j, tz};
-        temp_pm = {j + 1, j - 1, 1, j, tz};
-        temp_pp = {j + 1, j + 1, 1, j, tz};
-        partial_waves.push_back(temp_mm);
-        partial_waves.push_back(temp_mp);
-        partial_waves.push_back(temp_pm);
-        partial_waves.push_back(temp_pp);
+        if (iss >> j >> tz) // the table may be empty.
+        {
+            temp_mm = {j - 1, j - 1, 1, j, tz};
+            temp_mp = {j - 1, j + 1, 1, j, tz};
+            temp_pm = {j + 1, j - 1, 1, j, tz};
+            temp_pp = {j + 1, j + 1, 1, j, tz};
+            partial_waves.push_back(temp_mm);
+            partial_waves.push_back(temp_mp);
+            partial_waves.push_back(temp_pm);
+            partial_waves.push_back(temp_pp);
+        }
         while (file >> j >> tz)
         {
             temp_mm = {j - 1, j - 1, 1, j, tz};
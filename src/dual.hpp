@@ -0,0 +1,127 @@
+#pragma once
+#ifndef DUAL_HPP
+#define DUAL_HPP
+
+#include <array>
+#include <cmath>
+#include <string>
+#include <type_traits>
+
+// forward-mode automatic differentiation: a dual number carries a value and its derivatives with respect to up to
+// "max_parameters" parameters, all propagated by every operation. the value part is computed with the same
+// operations as a plain double, so the values of a dual evaluation are bit-identical to the double evaluation.
+namespace dual_numbers
+{
+    // parameters a kernel can be differentiated with respect to, and their names in the ini file.
+    enum parameter
+    {
+        ga,
+        fpi,
+        mpi_charged,
+        mpi_neutral,
+        mpi_averaged,
+        lambda,
+        lambda_tilde,
+        parameter_number
+    };
+    const std::array<std::string, parameter_number> parameter_names = {"ga", "fpi", "mpi_charged", "mpi_neutral", "mpi_averaged", "lambda", "lambda_tilde"};
+
+    constexpr size_t max_parameters = parameter_number;
+
+    struct dual
+    {
+        double v;
+        std::array<double, max_parameters> d;
+
+        dual(double value = 0.0) : v(value) { d.fill(0.0); }
+        explicit operator double() const { return v; }
+
+        dual &operator+=(const dual &b)
+        {
+            v += b.v;
+            for (size_t k = 0; k < max_parameters; k = k + 1)
+            {
+                d[k] += b.d[k];
+            }
+            return *this;
+        }
+        dual &operator-=(const dual &b)
+        {
+            v -= b.v;
+            for (size_t k = 0; k < max_parameters; k = k + 1)
+            {
+                d[k] -= b.d[k];
+            }
+            return *this;
+        }
+        dual &operator*=(const dual &b)
+        {
+            for (size_t k = 0; k < max_parameters; k = k + 1)
+            {
+                d[k] = d[k] * b.v + v * b.d[k];
+            }
+            v *= b.v;
+            return *this;
+        }
+        dual &operator/=(const dual &b)
+        {
+            double inv = 1.0 / b.v;
+            for (size_t k = 0; k < max_parameters; k = k + 1)
+            {
+                d[k] = (d[k] * b.v - v * b.d[k]) * inv * inv;
+            }
+            v /= b.v;
+            return *this;
+        }
+    };
+
+    // f(a) with value "value" and derivative "slope" = f'(a.v).
+    inline dual chain(const dual &a, double value, double slope)
+    {
+        dual r(value);
+        for (size_t k = 0; k < max_parameters; k = k + 1)
+        {
+            r.d[k] = slope * a.d[k];
+        }
+        return r;
+    }
+
+    inline dual operator+(dual a, const dual &b) { return a += b; }
+    inline dual operator-(dual a, const dual &b) { return a -= b; }
+    inline dual operator*(dual a, const dual &b) { return a *= b; }
+    inline dual operator/(dual a, const dual &b) { return a /= b; }
+    inline dual operator-(const dual &a) { return chain(a, -a.v, -1.0); }
+
+    inline bool operator<(const dual &a, const dual &b) { return a.v < b.v; }
+    inline bool operator>(const dual &a, const dual &b) { return a.v > b.v; }
+    inline bool operator<=(const dual &a, const dual &b) { return a.v <= b.v; }
+    inline bool operator>=(const dual &a, const dual &b) { return a.v >= b.v; }
+
+    inline dual sqrt(const dual &a)
+    {
+        double r = std::sqrt(a.v);
+        return chain(a, r, 0.5 / r);
+    }
+    inline dual exp(const dual &a)
+    {
+        double r = std::exp(a.v);
+        return chain(a, r, r);
+    }
+    inline dual log(const dual &a) { return chain(a, std::log(a.v), 1.0 / a.v); }
+    inline dual log1p(const dual &a) { return chain(a, std::log1p(a.v), 1.0 / (1.0 + a.v)); }
+    inline dual atan(const dual &a) { return chain(a, std::atan(a.v), 1.0 / (1.0 + a.v * a.v)); }
+    inline dual abs(const dual &a) { return a.v < 0.0 ? -a : a; }
+    inline dual pow(const dual &a, int n) { return chain(a, std::pow(a.v, n), n == 0 ? 0.0 : n * std::pow(a.v, n - 1)); }
+
+    template <typename T>
+    struct is_dual : std::false_type
+    {
+    };
+    template <>
+    struct is_dual<dual> : std::true_type
+    {
+    };
+
+} // namespace dual_numbers
+
+#endif // DUAL_HPP
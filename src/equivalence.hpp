@@ -0,0 +1,300 @@
+#pragma once
+#ifndef EQUIVALENCE_HPP
+#define EQUIVALENCE_HPP
+
+#include "angular_quadrature.hpp"
+#include "interaction_all.hpp"
+#include "kernel_output.hpp"
+#include "lib_define.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+// numerical-equivalence check of the optimized evaluation paths against the reference potential_chiral.
+// run with "NN-cms.x --check-equivalence", options are read from the optional [equivalence] section.
+namespace equivalence
+{
+    // an evaluation path returns the full row-major matrix of one channel.
+    // approximate paths (reduced precision, adaptive angular rules, analytic ope, screening) are only checked when they are named in "paths".
+    struct evaluation_path
+    {
+        std::string name;
+        std::function<std::vector<double>(const std::vector<int> &, const NN::NN_configs &)> potential_matrix;
+        bool approximate = false;
+    };
+
+    struct settings
+    {
+        std::vector<std::string> paths; // empty: all registered paths that are not approximate.
+        int64_t max_ulp = 64;           // element passes if within max_ulp ...
+        double max_rel = 1e-12;         // ... or within max_rel relative to max(|ref|, abs_floor * channel peak).
+        double abs_floor = 1e-10;
+        size_t worst_elements = 5;
+        size_t mesh_stride = 1; // use every mesh_stride-th momentum point.
+    };
+
+    struct element_difference
+    {
+        size_t idx_bra, idx_ket;
+        double reference, value;
+        uint64_t ulp;
+        double rel;
+    };
+
+    // distance in units in the last place between two doubles.
+    uint64_t ulp_distance(double a, double b)
+    {
+        if (a == b)
+        {
+            return 0;
+        }
+        if (std::isnan(a) || std::isnan(b))
+        {
+            return UINT64_MAX;
+        }
+        int64_t ia, ib;
+        std::memcpy(&ia, &a, sizeof(double));
+        std::memcpy(&ib, &b, sizeof(double));
+        // map the sign-magnitude bit patterns onto a monotonic integer line.
+        if (ia < 0)
+        {
+            ia = INT64_MIN - ia;
+        }
+        if (ib < 0)
+        {
+            ib = INT64_MIN - ib;
+        }
+        return (ia > ib) ? static_cast<uint64_t>(ia) - static_cast<uint64_t>(ib) : static_cast<uint64_t>(ib) - static_cast<uint64_t>(ia);
+    }
+
+    // every evaluation path known to the harness. the first one is the reference.
+    std::vector<evaluation_path> registered_paths()
+    {
+        std::vector<evaluation_path> paths;
+        paths.push_back({"reference", [](const std::vector<int> &channel, const NN::NN_configs &configs)
+                         { return interaction_all::potential_matrix(channel, configs); }});
+        // the reference with a single openmp thread, exposes thread-count dependent summation order.
+        paths.push_back({"reference-single-thread", [](const std::vector<int> &channel, const NN::NN_configs &configs)
+                         {
+                             int threads = omp_get_max_threads();
+                             omp_set_num_threads(1);
+                             auto v = interaction_all::potential_matrix(channel, configs);
+                             omp_set_num_threads(threads);
+                             return v; }});
+        paths.push_back({"float", [](const std::vector<int> &channel, const NN::NN_configs &configs)
+                         { return interaction_all::potential_matrix<float>(channel, configs); },
+                         true});
+        paths.push_back({"adaptive-angular", [](const std::vector<int> &channel, const NN::NN_configs &configs)
+                         { return angular_quadrature::potential_matrix(channel, configs, angular_quadrature::make_plan(channel, configs)); },
+                         true});
+        // one-pion exchange projected in closed form, differs from the reference by its angular quadrature error.
+        paths.push_back({"analytic-ope", [](const std::vector<int> &channel, const NN::NN_configs &configs)
+                         {
+                             NN::NN_configs analytic = configs;
+                             analytic.ope_projection = "analytic";
+                             return interaction_all::potential_matrix(channel, analytic); },
+                         true});
+        // two-pion exchange as sums of yukawa projections, differs from the reference by its angular quadrature error.
+        paths.push_back({"spectral-tpe", [](const std::vector<int> &channel, const NN::NN_configs &configs)
+                         {
+                             NN::NN_configs spectral = configs;
+                             spectral.tpe_projection = "spectral";
+                             spectral.set_two_pion_exchange_expansion();
+                             return interaction_all::potential_matrix(channel, spectral); },
+                         true});
+        // regulator screening with the fixed angular rule, the screened elements are zeros.
+        paths.push_back({"screened", [](const std::vector<int> &channel, const NN::NN_configs &configs)
+                         {
+                             NN::NN_configs fixed = configs;
+                             fixed.angular_mode = "fixed";
+                             fixed.precision = "double";
+                             auto plans = screening::make_plans(fixed);
+                             size_t idx = std::find(fixed.partial_waves.begin(), fixed.partial_waves.end(), channel) - fixed.partial_waves.begin();
+                             return kernel_output::compute_channel(channel, fixed, &plans[idx]); },
+                         true});
+        return paths;
+    }
+
+    settings read_settings(const inifile_system::inifile &ini)
+    {
+        settings st;
+        if (!ini.has_section("equivalence"))
+        {
+            return st;
+        }
+        auto sec = ini.section("equivalence");
+        if (sec.has_key("paths"))
+        {
+            std::istringstream iss(sec.get_string("paths"));
+            std::string name;
+            while (std::getline(iss, name, ','))
+            {
+                name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
+                if (!name.empty())
+                {
+                    st.paths.push_back(name);
+                }
+            }
+        }
+        if (sec.has_key("max_ulp"))
+        {
+            st.max_ulp = sec.get_int("max_ulp");
+        }
+        if (sec.has_key("max_rel"))
+        {
+            st.max_rel = sec.get_double("max_rel");
+        }
+        if (sec.has_key("abs_floor"))
+        {
+            st.abs_floor = sec.get_double("abs_floor");
+        }
+        if (sec.has_key("worst_elements"))
+        {
+            st.worst_elements = sec.get_int("worst_elements");
+        }
+        if (sec.has_key("mesh_stride"))
+        {
+            st.mesh_stride = std::max<int64_t>(1, sec.get_int("mesh_stride"));
+        }
+        return st;
+    }
+
+    // compare all selected paths against the reference on every channel of "configs".
+    // returns the number of channels that fail the tolerances.
+    size_t run(const NN::NN_configs &full_configs, const settings &st)
+    {
+        // optionally thin out the momentum mesh.
+        auto configs = full_configs;
+        configs.momentum_mesh_points.clear();
+        configs.momentum_mesh_weights.clear();
+        for (size_t i = 0; i < full_configs.mesh_points_number; i = i + st.mesh_stride)
+        {
+            configs.momentum_mesh_points.push_back(full_configs.momentum_mesh_points[i]);
+            configs.momentum_mesh_weights.push_back(full_configs.momentum_mesh_weights[i]);
+        }
+        configs.mesh_points_number = configs.momentum_mesh_points.size();
+        size_t n = configs.mesh_points_number;
+
+        auto paths = registered_paths();
+        const auto &reference = paths.front();
+        std::vector<evaluation_path> selected;
+        for (size_t i = 1; i < paths.size(); i = i + 1)
+        {
+            if ((st.paths.empty() && !paths[i].approximate) || std::find(st.paths.begin(), st.paths.end(), paths[i].name) != st.paths.end())
+            {
+                selected.push_back(paths[i]);
+            }
+        }
+        for (const auto &name : st.paths)
+        {
+            if (std::none_of(paths.begin(), paths.end(), [&name](const evaluation_path &p)
+                             { return p.name == name; }))
+            {
+                std::cerr << "unknown evaluation path: " << name << std::endl;
+                exit(-1);
+            }
+        }
+
+        std::cout << "---- equivalence check on " << configs.partial_waves.size() << " channels, " << n << " x " << n << " elements, max_ulp = " << st.max_ulp
+                  << ", max_rel = " << st.max_rel << "\n\n";
+
+        size_t failures = 0;
+        for (const auto &channel : configs.partial_waves)
+        {
+            auto v_ref = reference.potential_matrix(channel, configs);
+            double peak = 0.0;
+            for (auto v : v_ref)
+            {
+                peak = std::max(peak, std::fabs(v));
+            }
+            double floor = st.abs_floor * peak;
+
+            for (const auto &path : selected)
+            {
+                auto v_path = path.potential_matrix(channel, configs);
+                std::vector<element_difference> diffs;
+                size_t failed_elements = 0;
+                for (size_t idx = 0; idx < n * n; idx = idx + 1)
+                {
+                    element_difference d;
+                    d.idx_bra = idx / n;
+                    d.idx_ket = idx % n;
+                    d.reference = v_ref[idx];
+                    d.value = v_path[idx];
+                    d.ulp = ulp_distance(d.reference, d.value);
+                    d.rel = std::fabs(d.value - d.reference) / std::max(std::fabs(d.reference), floor);
+                    if (d.ulp > static_cast<uint64_t>(st.max_ulp) && !(d.rel <= st.max_rel))
+                    {
+                        failed_elements = failed_elements + 1;
+                    }
+                    diffs.push_back(d);
+                }
+                size_t k = std::min(st.worst_elements, diffs.size());
+                std::partial_sort(diffs.begin(), diffs.begin() + k, diffs.end(), [](const element_difference &a, const element_difference &b)
+                                  { return a.rel > b.rel || (a.rel == b.rel && a.ulp > b.ulp); });
+                bool pass = (failed_elements == 0);
+                if (!pass)
+                {
+                    failures = failures + 1;
+                }
+                std::cout << (pass ? "PASS " : "FAIL ") << std::left << std::setw(14) << kernel_output::channel_tag(channel) << std::setw(28) << path.name << std::right
+                          << " failed elements: " << failed_elements << "/" << n * n << std::scientific << std::setprecision(3) << ", max rel: " << diffs.front().rel
+                          << ", max ulp: " << diffs.front().ulp << std::endl;
+                for (size_t i = 0; i < k && diffs[i].ulp > 0; i = i + 1)
+                {
+                    const auto &d = diffs[i];
+                    std::cout << "       p' = " << configs.momentum_mesh_points[d.idx_bra] << ", p = " << configs.momentum_mesh_points[d.idx_ket] << std::setprecision(17)
+                              << ", ref = " << d.reference << ", path = " << d.value << std::setprecision(3) << ", rel = " << d.rel << ", ulp = " << d.ulp << std::endl;
+                }
+            }
+        }
+        std::cout << "\n---- equivalence check: " << failures << " failing channel/path pairs" << std::endl;
+        return failures;
+    }
+
+    // error of the "float" precision path against double, per channel: the maximum
+    // element-wise relative error, relative to max(|V|, abs_floor * channel peak), and the maximum
+    // error relative to the channel peak. the cheapest precision whose peak-relative error is within
+    // "tolerance" is printed for every channel and the table is written to result_dir/result_name-precision-report.txt.
+    void precision_report(const NN::NN_configs &configs, double tolerance, double abs_floor)
+    {
+        size_t n = configs.mesh_points_number;
+        std::string fname = configs.result_dir + configs.result_name + "-precision-report.txt";
+        std::ofstream fp(fname);
+        fp << "# channel; float: max element rel error, max peak rel error; cheapest precision within "
+           << tolerance << "\n";
+        std::cout << "---- precision report, tolerance = " << tolerance << " relative to the channel peak\n\n";
+        for (const auto &channel : configs.partial_waves)
+        {
+            auto v_double = interaction_all::potential_matrix<double>(channel, configs);
+            auto v_float = interaction_all::potential_matrix<float>(channel, configs);
+            double peak = 0.0;
+            for (auto v : v_double)
+            {
+                peak = std::max(peak, std::fabs(v));
+            }
+            double floor = abs_floor * peak;
+            double err_element = 0.0, err_peak = 0.0;
+            for (size_t idx = 0; idx < n * n; idx = idx + 1)
+            {
+                double diff = std::fabs(v_float[idx] - v_double[idx]);
+                double scale = std::max(std::fabs(v_double[idx]), floor);
+                if (scale > 0.0)
+                {
+                    err_element = std::max(err_element, diff / scale);
+                    err_peak = std::max(err_peak, diff / peak);
+                }
+            }
+            std::string cheapest = (err_peak <= tolerance) ? "float" : "double";
+            std::cout << std::left << std::setw(14) << kernel_output::channel_tag(channel) << std::right << std::scientific << std::setprecision(3) << "  float: " << err_element
+                      << " (peak " << err_peak << ")  -> " << cheapest << std::endl;
+            fp << kernel_output::channel_tag(channel) << " " << std::scientific << std::setprecision(6) << err_element << " " << err_peak << " " << cheapest << "\n";
+        }
+        fp.close();
+        std::cout << "\n---- precision report written in: " << fname << std::endl;
+    }
+
+} // namespace equivalence
+
+#endif // EQUIVALENCE_HPP
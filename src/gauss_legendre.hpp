@@ -1,6 +1,8 @@
 #ifndef GAUSSLEGENDRERULE_HPP
 #define GAUSSLEGENDRERULE_HPP
 
+#include <vector>
+
 namespace GaussLegendre
 {
     /**
@@ -10,32 +12,42 @@ namespace GaussLegendre
     class GaussLegendrePoint
     {
     public:
-        GaussLegendrePoint(int order, double *node, double *weight);
+        GaussLegendrePoint(int order, std::vector<double> node, std::vector<double> weight);
         GaussLegendrePoint(int order);
         GaussLegendrePoint();
 
-        double getNode(int i);
-        double getWeight(int i);
-        int getOrder();
+        double getNode(int i) const;
+        double getWeight(int i) const;
+        int getOrder() const;
 
         void setNode(int i, double value);
         void setWeight(int i, double value);
 
-        ~GaussLegendrePoint();
-
     private:
-        double *node;
-        double *weight;
+        std::vector<double> node;
+        std::vector<double> weight;
         int order;
 
-        bool isNodeNUll();
-        bool isWeightNUll();
-        void init(int order, double *node, double *weight);
-        void validateNodeAndWeight(int i);
-        void setNodePtr(double *node);
-        void setWeightPtr(double *weight);
+        void validateNodeAndWeight(int i) const;
         void setOrder(int order);
     };
+
+    /**
+     * Purpose:
+     *	Nodes and weights of an n-point Gauss-Legendre rule over the interval (a,b), in increasing order of the nodes.
+     */
+    struct Rule
+    {
+        std::vector<double> nodes;
+        std::vector<double> weights;
+    };
+
+    /**
+     * Purpose:
+     *	Returns the n-point rule over (a,b). Rules are computed once per (n,a,b) and cached, the call is thread-safe
+     *	and the reference stays valid for the lifetime of the program.
+     */
+    const Rule &getRule(int n, double a, double b);
 }
 
 /**
@@ -47,11 +59,11 @@ class GaussLegendreRule
 public:
     GaussLegendreRule(int n, double a, double b);
 
-    double getNode(int i);
-    double getWeight(int i);
-    double getOrder();
-    double getLowerBound();
-    double getUpperBound();
+    double getNode(int i) const;
+    double getWeight(int i) const;
+    double getOrder() const;
+    double getLowerBound() const;
+    double getUpperBound() const;
 
 private:
     int n;
@@ -60,7 +72,7 @@ private:
     GaussLegendre::GaussLegendrePoint gaussLegendrePoint;
 
     void setGaussLegendrePoint();
-    void mapGaussLegendrePoint(GaussLegendre::GaussLegendrePoint &negativeZeroOne);
+    void mapGaussLegendrePoint(const GaussLegendre::GaussLegendrePoint &negativeZeroOne);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,225 @@
+#pragma once
+#ifndef HO_TRANSFORM_HPP
+#define HO_TRANSFORM_HPP
+
+#include "kernel_output.hpp"
+#include "linear_algebra.hpp"
+#include "lib_define.hpp"
+
+// "NN-cms.x --ho": relative harmonic-oscillator matrix elements <n' l'|V|n l> of the channels of the tables,
+//     <n' l'|V|n l> = int dp' p'^2 int dp p^2 R_n'l'(p') V(p', p) R_nl(p),
+// on the momentum mesh, for 2n + l <= n_max and every hbar_omega. with the oscillator length b = 1 / sqrt(mu hbar_omega)
+// in MeV^-1 (hbarc b in fm) of the reduced mass mu = mass_nucleon / 2, the momentum-space radial functions are
+//     R_nl(p) = (-1)^n sqrt(2 n! / Gamma(n + l + 3/2)) b^3/2 (pb)^l exp(-(pb)^2 / 2) L_n^(l+1/2)((pb)^2),
+// normalized to int dp p^2 R_nl^2 = 1. with Phi_kn = R_nl(p_k) and W = diag(w_k p_k^2) the matrix of one channel
+// is the two matrix products (W Phi_l')^T (V (W Phi_l)). the kernels are computed once and shared by all hbar_omega.
+namespace ho_transform
+{
+    struct settings
+    {
+        std::vector<double> hbar_omegas; // MeV.
+        size_t n_max;                    // 2n + l <= n_max.
+    };
+
+    // optional [ho] section, "hbar_omegas = 16, 20, 24".
+    settings read_settings(const inifile_system::inifile &ini)
+    {
+        settings st{{20.0}, 20};
+        if (ini.has_section("ho"))
+        {
+            auto sec = ini.section("ho");
+            if (sec.has_key("hbar_omegas"))
+            {
+                st.hbar_omegas.clear();
+                std::istringstream iss(sec.get_string("hbar_omegas"));
+                std::string value;
+                while (std::getline(iss, value, ','))
+                {
+                    st.hbar_omegas.push_back(std::stod(value));
+                }
+            }
+            int64_t n_max = sec.has_key("n_max") ? sec.get_int("n_max") : int64_t(st.n_max);
+            if (n_max < 0)
+            {
+                std::cerr << "n_max must not be negative: " << n_max << std::endl;
+                exit(-1);
+            }
+            st.n_max = n_max;
+        }
+        if (st.hbar_omegas.empty() || *std::min_element(st.hbar_omegas.begin(), st.hbar_omegas.end()) <= 0.0)
+        {
+            std::cerr << "the oscillator transform needs positive hbar_omegas" << std::endl;
+            exit(-1);
+        }
+        return st;
+    }
+
+    // file of the matrix elements at "hbar_omega", e.g. "data-cms/n2lo-emn500-ho-hw20.00.txt".
+    std::string file_name(const NN::NN_configs &configs, double hbar_omega)
+    {
+        std::ostringstream oss;
+        oss << configs.result_dir << configs.result_name << "-ho-hw" << std::fixed << std::setprecision(2) << hbar_omega << ".txt";
+        return oss.str();
+    }
+
+    // W Phi_l: w_k p_k^2 R_nl(p_k) for the mesh points k (rows) and n = 0 .. (n_max - l) / 2 (columns).
+    std::vector<double> weighted_radial_functions(int l, size_t n_max, double b, const NN::NN_configs &configs)
+    {
+        const auto &p = configs.momentum_mesh_points;
+        const auto &w = configs.momentum_mesh_weights;
+        size_t mesh = p.size();
+        size_t columns = size_t(l) > n_max ? 0 : (n_max - l) / 2 + 1;
+        std::vector<double> phi(mesh * columns);
+        double alpha = l + 0.5;
+        for (size_t k = 0; k < mesh; k = k + 1)
+        {
+            double x = p[k] * b;
+            double x2 = x * x;
+            double common = std::pow(b, 1.5) * std::pow(x, l) * std::exp(-0.5 * x2) * w[k] * p[k] * p[k];
+            // generalized laguerre polynomials by their three-term recurrence.
+            double laguerre_previous = 0.0, laguerre = 1.0;
+            for (size_t n = 0; n < columns; n = n + 1)
+            {
+                if (n > 0)
+                {
+                    double next = ((2.0 * (n - 1) + 1.0 + alpha - x2) * laguerre - (n - 1 + alpha) * laguerre_previous) / n;
+                    laguerre_previous = laguerre;
+                    laguerre = next;
+                }
+                double norm = std::sqrt(2.0 * std::exp(std::lgamma(n + 1.0) - std::lgamma(n + alpha + 1.0)));
+                phi[k * columns + n] = (n % 2 == 0 ? 1.0 : -1.0) * norm * common * laguerre;
+            }
+        }
+        return phi;
+    }
+
+    // largest deviation of sum_k w_k p_k^2 R_nl(p_k) R_n'l(p_k) from delta_nn' for l <= l_max, the mesh must resolve the functions.
+    double orthonormality_error(size_t n_max, int l_max, double b, const NN::NN_configs &configs)
+    {
+        const auto &p = configs.momentum_mesh_points;
+        double error = 0.0;
+        for (int l = 0; l <= std::min<int>(l_max, n_max); l = l + 1)
+        {
+            auto phi = weighted_radial_functions(l, n_max, b, configs);
+            size_t columns = (n_max - l) / 2 + 1;
+            for (size_t n1 = 0; n1 < columns; n1 = n1 + 1)
+            {
+                for (size_t n2 = 0; n2 < columns; n2 = n2 + 1)
+                {
+                    double sum = 0.0;
+                    for (size_t k = 0; k < p.size(); k = k + 1)
+                    {
+                        // divide one weighted function by its weight w_k p_k^2 again.
+                        double r = phi[k * columns + n2] / (configs.momentum_mesh_weights[k] * p[k] * p[k]);
+                        sum += phi[k * columns + n1] * r;
+                    }
+                    error = std::max(error, std::abs(sum - (n1 == n2 ? 1.0 : 0.0)));
+                }
+            }
+        }
+        return error;
+    }
+
+    // matrix elements (n' rows, n columns) of one channel with its row-major kernel "v".
+    std::vector<double> transform(const std::vector<int> &channel, const std::vector<double> &v, size_t n_max, double b, const NN::NN_configs &configs,
+                                  size_t &rows, size_t &columns)
+    {
+        size_t mesh = configs.mesh_points_number;
+        auto phi_final = weighted_radial_functions(channel[0], n_max, b, configs);
+        auto phi_initial = weighted_radial_functions(channel[1], n_max, b, configs);
+        rows = phi_final.size() / mesh;
+        columns = phi_initial.size() / mesh;
+        if (rows == 0 || columns == 0)
+        {
+            return {};
+        }
+        // V (W Phi_l), then (W Phi_l')^T of it.
+        std::vector<double> right, transposed(rows * mesh), result;
+        linear_algebra::multiply(v, phi_initial, right, mesh, mesh, columns);
+        for (size_t k = 0; k < mesh; k = k + 1)
+        {
+            for (size_t n = 0; n < rows; n = n + 1)
+            {
+                transposed[n * mesh + k] = phi_final[k * rows + n];
+            }
+        }
+        linear_algebra::multiply(transposed, right, result, rows, mesh, columns);
+        return result;
+    }
+
+    // matrix elements of all channels at all hbar_omega, one file per hbar_omega.
+    void run(const inifile_system::inifile &ini, const NN::NN_configs &configs)
+    {
+        auto st = read_settings(ini);
+        const auto &channels = configs.partial_waves;
+        double mu = 0.5 * configs.mass_nucleon;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::vector<double>> kernels(channels.size());
+        for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+        {
+            kernels[idx] = kernel_output::compute_channel(channels[idx], configs);
+        }
+        auto kernels_end = std::chrono::steady_clock::now();
+
+        // one task per (hbar_omega, channel), in parallel if there are enough of them, otherwise the matrix products.
+        size_t tasks = st.hbar_omegas.size() * channels.size();
+        std::vector<std::vector<double>> results(tasks);
+        std::vector<std::pair<size_t, size_t>> shapes(tasks);
+        bool parallel_tasks = tasks >= configs.thread_number;
+#pragma omp parallel for schedule(dynamic) if (parallel_tasks)
+        for (size_t task = 0; task < tasks; task = task + 1)
+        {
+            double hbar_omega = st.hbar_omegas[task / channels.size()];
+            size_t idx = task % channels.size();
+            double b = 1.0 / std::sqrt(mu * hbar_omega);
+            results[task] = transform(channels[idx], kernels[idx], st.n_max, b, configs, shapes[task].first, shapes[task].second);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        int l_max = 0;
+        for (const auto &channel : channels)
+        {
+            l_max = std::max({l_max, channel[0], channel[1]});
+        }
+        for (size_t idx_hw = 0; idx_hw < st.hbar_omegas.size(); idx_hw = idx_hw + 1)
+        {
+            double hbar_omega = st.hbar_omegas[idx_hw];
+            double b = 1.0 / std::sqrt(mu * hbar_omega);
+            double error = orthonormality_error(st.n_max, l_max, b, configs);
+            std::string fname = file_name(configs, hbar_omega);
+            std::ofstream fp(fname);
+            fp << "# relative oscillator matrix elements <n' l'|V|n l> in MeV of " << configs.result_name << ", hbar_omega = " << hbar_omega << " MeV, b = " << constants::hbarc * b
+               << " fm, n_max = " << st.n_max << "\n"
+               << "# largest orthonormality error of the oscillator functions on the momentum mesh: " << error << "\n"
+               << "# per channel l'-l-s-j-tz: n' n value\n";
+            fp << std::scientific << std::setprecision(17);
+            for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+            {
+                const auto &r = results[idx_hw * channels.size() + idx];
+                auto shape = shapes[idx_hw * channels.size() + idx];
+                fp << "\n# " << kernel_output::channel_tag(channels[idx]) << "\n";
+                for (size_t n1 = 0; n1 < shape.first; n1 = n1 + 1)
+                {
+                    for (size_t n2 = 0; n2 < shape.second; n2 = n2 + 1)
+                    {
+                        fp << n1 << " " << n2 << " " << r[n1 * shape.second + n2] << "\n";
+                    }
+                }
+            }
+            std::cout << "writing: " << fname << std::endl;
+            if (error > 1e-6)
+            {
+                std::cout << "warning: the momentum mesh does not resolve the oscillator functions at hbar_omega = " << hbar_omega << " MeV, orthonormality error " << error << std::endl;
+            }
+        }
+
+        std::cout.precision(4);
+        std::cout << "---- oscillator matrix elements of " << channels.size() << " channels at " << st.hbar_omegas.size() << " hbar_omega, n_max = " << st.n_max << "\n"
+                  << "     mesh kernels: " << std::chrono::duration<double>(kernels_end - start).count() << " s, transform: "
+                  << std::chrono::duration<double>(end - kernels_end).count() << " s" << std::endl;
+    }
+
+} // namespace ho_transform
+
+#endif // HO_TRANSFORM_HPP
@@ -8,9 +8,11 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+// missing sections or keys and invalid values throw std::runtime_error.
 namespace inifile_system
 {
     static constexpr const char *ini_comment_delimiter[] = {
@@ -43,13 +45,27 @@ namespace inifile_system
             int64_t get_int(const std::string &key) const
             {
                 auto pos = check_key(key);
-                return std::stoll(pos->value);
+                try
+                {
+                    return std::stoll(pos->value);
+                }
+                catch (const std::logic_error &)
+                {
+                    throw std::runtime_error("Section " + this->name + ", key " + key + ", invalid integer value: " + pos->value);
+                }
             }
 
             double get_double(const std::string &key) const
             {
                 auto pos = check_key(key);
-                return std::stod(pos->value);
+                try
+                {
+                    return std::stod(pos->value);
+                }
+                catch (const std::logic_error &)
+                {
+                    throw std::runtime_error("Section " + this->name + ", key " + key + ", invalid number value: " + pos->value);
+                }
             }
 
             bool get_bool(const std::string &key) const
@@ -60,9 +76,7 @@ namespace inifile_system
                     return true;
                 if (value == "false" || value == "0")
                     return false;
-                std::cerr << "Section " << this->name << ", key " << key << ", invalid bool value: " << pos->value
-                          << std::endl;
-                std::exit(-1);
+                throw std::runtime_error("Section " + this->name + ", key " + key + ", invalid bool value: " + pos->value);
             }
 
             void set_string(const std::string &key, const std::string &value)
@@ -114,8 +128,7 @@ namespace inifile_system
                 auto pos = find_key(key);
                 if (pos == items.end())
                 {
-                    std::cerr << "Section " << this->name << ", key not found: " << key << std::endl;
-                    std::exit(-1);
+                    throw std::runtime_error("Section " + this->name + ", key not found: " + key);
                 }
                 return pos;
             }
@@ -125,8 +138,7 @@ namespace inifile_system
                 auto pos = find_key(key);
                 if (pos == items.cend())
                 {
-                    std::cerr << "Section " << this->name << ", key not found: " << key << std::endl;
-                    std::exit(-1);
+                    throw std::runtime_error("Section " + this->name + ", key not found: " + key);
                 }
                 return pos;
             }
@@ -209,6 +221,30 @@ namespace inifile_system
             save_file.close();
         }
 
+        bool has_section(const std::string &name) const
+        {
+            return std::find_if(sections.cbegin(), sections.cend(), [&name](const IniSection &sec)
+                                { return sec.name == name; }) != sections.cend();
+        }
+
+        std::vector<std::string> section_names() const
+        {
+            std::vector<std::string> names;
+            for (const auto &sec : sections)
+            {
+                if (sec.name != "")
+                    names.push_back(sec.name);
+            }
+            return names;
+        }
+
+        IniSection &add_section(const std::string &name)
+        {
+            if (!has_section(name))
+                sections.push_back(IniSection{name});
+            return section(name);
+        }
+
         IniSection &section(const std::string &name = "") { return *check_section(name); }
         const IniSection &section(const std::string &name = "") const { return *check_section(name); }
 
@@ -290,11 +326,7 @@ namespace inifile_system
                              { return sec.name == name; });
             if (pos == sections.end())
             {
-                if (name == "")
-                    std::cerr << "on default section" << std::endl;
-                else
-                    std::cerr << "section not found: " << name << std::endl;
-                std::exit(-1);
+                throw std::runtime_error(name == "" ? "on default section" : "section not found: " + name);
             }
             return pos;
         }
@@ -306,11 +338,7 @@ namespace inifile_system
                                     { return sec.name == name; });
             if (pos == sections.cend())
             {
-                if (name == "")
-                    std::cerr << "on default section" << std::endl;
-                else
-                    std::cerr << "section not found: " << name << std::endl;
-                std::exit(-1);
+                throw std::runtime_error(name == "" ? "on default section" : "section not found: " + name);
             }
             return pos;
         }
@@ -3,6 +3,7 @@
 #define INTERACTION_aPWD_HPP
 
 #include "lib_define.hpp"
+#include "profiler.hpp"
 
 namespace interaction_aPWD
 {
@@ -13,20 +14,88 @@ namespace interaction_aPWD
 
     // redefine for C++ 17.
     constexpr double Pi = 3.14159265358979323846;
-    double Power(const double &x, const int &n) { return std::pow(x, n); }
     double Sqrt(const double &x) { return std::sqrt(x); }
 
-    // automated partial-wave projection method.
-    double potential_auto(const int &l_final, const int &l_initial, const int &s, const int &j, const double &p_final, const double &p_initial, const double &x, const std::vector<double> &f_component_vec)
+    // integer power, std::pow for double (and the values of dual numbers) keeps the reference results, other scalar types
+    // multiply in their own precision.
+    template <typename T>
+    T Power(const T &x, const int &n)
     {
-        double f1 = f_component_vec[0];
-        double f2 = f_component_vec[1];
-        double f3 = f_component_vec[2];
-        double f4 = f_component_vec[3];
-        double f5 = f_component_vec[4];
-        double f6 = f_component_vec[5];
-        double pmag = p_initial;
-        double ppmag = p_final;
+        if constexpr (std::is_same<T, double>::value || dual_numbers::is_dual<T>::value)
+        {
+            using std::pow;
+            return pow(x, n);
+        }
+        else
+        {
+            T result = T(1);
+            for (int i = 0; i < n; i = i + 1)
+            {
+                result = result * x;
+            }
+            return result;
+        }
+    }
+
+    // value of a nonlinear parameter: a plain double, or for dual numbers a dual seeded with a unit derivative
+    // if the parameter is one of configs.derivatives. parameter_type<T> keeps the double path unchanged.
+    template <typename T>
+    using parameter_type = std::conditional_t<dual_numbers::is_dual<T>::value, dual_numbers::dual, double>;
+
+    template <typename T>
+    parameter_type<T> parameter(const double &value, dual_numbers::parameter id, const NN::NN_configs &configs)
+    {
+        parameter_type<T> result = value;
+        if constexpr (dual_numbers::is_dual<T>::value)
+        {
+            if (std::find(configs.derivatives.begin(), configs.derivatives.end(), id) != configs.derivatives.end())
+            {
+                result.d[id] = 1.0;
+            }
+        }
+        return result;
+    }
+
+    // highest total angular momentum J of the generated expressions below.
+    constexpr int j_max = 10;
+
+    // true if "potential_auto" has an expression for the channel [l', l, s, j]: s = 0 with l' = l = j,
+    // s = 1 with l' = l = j >= 1, or s = 1 with l', l = j -+ 1, all up to j_max.
+    bool supported(const int &l_final, const int &l_initial, const int &s, const int &j)
+    {
+        if (j < 0 || j > j_max)
+        {
+            return false;
+        }
+        if (s == 0)
+        {
+            return l_final == j && l_initial == j;
+        }
+        if (s != 1)
+        {
+            return false;
+        }
+        if (l_final == j && l_initial == j)
+        {
+            return j >= 1;
+        }
+        auto coupled = [&j](int l)
+        { return l >= 0 && (l == j - 1 || l == j + 1); };
+        return coupled(l_final) && coupled(l_initial);
+    }
+
+    // automated partial-wave projection method, templated on the scalar type.
+    template <typename T>
+    T potential_auto(const int &l_final, const int &l_initial, const int &s, const int &j, const T &p_final, const T &p_initial, const T &x, const std::vector<T> &f_component_vec)
+    {
+        T f1 = f_component_vec[0];
+        T f2 = f_component_vec[1];
+        T f3 = f_component_vec[2];
+        T f4 = f_component_vec[3];
+        T f5 = f_component_vec[4];
+        T f6 = f_component_vec[5];
+        T pmag = p_initial;
+        T ppmag = p_final;
 
         // the following expressions are all generated by Mathematica automatically!!!
         // I just do a copy-and-paste.
@@ -287,36 +356,45 @@ namespace interaction_aPWD
     }
 
     // regulator function used to cut-off high momentum part in the L-S equation.
-    double regulator_function(double p1, double p2, int n, NN::NN_configs configs)
+    template <typename T>
+    T regulator_function(const T &p1, const T &p2, int n, const NN::NN_configs &configs)
     {
-        double regulator = std::exp(-std::pow(p1 / configs.Lambda, 2 * n) - std::pow(p2 / configs.Lambda, 2 * n));
+        using std::exp, std::pow;
+        T lambda = parameter<T>(configs.Lambda, dual_numbers::lambda, configs);
+        T regulator = exp(-pow(p1 / lambda, 2 * n) - pow(p2 / lambda, 2 * n));
         return regulator;
     }
 
     // loop integral function.
-    double loop_function_L(double q, NN::NN_configs configs)
+    template <typename T>
+    T loop_function_L(const T &q, const NN::NN_configs &configs)
     {
-        double temp;
-        double lambda = configs.Lambda_tilde;
-        double mpi = configs.mass_pion_averaged;
-        double w = std::sqrt(4.0 * mpi * mpi + q * q);
-        double num = lambda * lambda * (2.0 * mpi * mpi + q * q) - 2.0 * mpi * mpi * q * q +
-                     lambda * std::sqrt(lambda * lambda - 4.0 * mpi * mpi) * q * w;
-        double den = 2.0 * mpi * mpi * (lambda * lambda + q * q);
-        double fac = w / (2.0 * q);
-        temp = fac * std::log(num / den);
+        profiler::scoped_timer timer(profiler::loop_functions);
+        using std::sqrt, std::log;
+        T temp;
+        T lambda = parameter<T>(configs.Lambda_tilde, dual_numbers::lambda_tilde, configs);
+        T mpi = parameter<T>(configs.mass_pion_averaged, dual_numbers::mpi_averaged, configs);
+        T w = sqrt(T(4.0) * mpi * mpi + q * q);
+        T num = lambda * lambda * (T(2.0) * mpi * mpi + q * q) - T(2.0) * mpi * mpi * q * q +
+                lambda * sqrt(lambda * lambda - T(4.0) * mpi * mpi) * q * w;
+        T den = T(2.0) * mpi * mpi * (lambda * lambda + q * q);
+        T fac = w / (T(2.0) * q);
+        temp = fac * log(num / den);
         return temp;
     }
 
-    double loop_function_A(double q, NN::NN_configs configs)
+    template <typename T>
+    T loop_function_A(const T &q, const NN::NN_configs &configs)
     {
-        double temp;
-        double lambda = configs.Lambda_tilde;
-        double mpi = configs.mass_pion_averaged;
-        double num = q * (lambda - 2.0 * mpi);
-        double den = q * q + 2.0 * lambda * mpi;
-        double fac = 1.0 / (2.0 * q);
-        temp = fac * std::atan(num / den);
+        profiler::scoped_timer timer(profiler::loop_functions);
+        using std::atan;
+        T temp;
+        T lambda = parameter<T>(configs.Lambda_tilde, dual_numbers::lambda_tilde, configs);
+        T mpi = parameter<T>(configs.mass_pion_averaged, dual_numbers::mpi_averaged, configs);
+        T num = q * (lambda - T(2.0) * mpi);
+        T den = q * q + T(2.0) * lambda * mpi;
+        T fac = T(1.0) / (T(2.0) * q);
+        temp = fac * atan(num / den);
         return temp;
     }
 
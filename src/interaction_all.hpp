@@ -5,48 +5,105 @@
 #include "interaction_part_pion_exchange.hpp"
 #include "interaction_part_contact.hpp"
 #include "lib_define.hpp"
+#include "ope_projection.hpp"
+#include "tpe_projection.hpp"
 #include <omp.h>
 
 namespace interaction_all
 {
     constexpr double twopicubic = 248.0502134423985614038105; // (2*Pi)^3
 
-    double potential_chiral(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const double &p_final, const double &p_initial, const NN::NN_configs &configs)
+    // relativity factor applied with the normalization constant (2Pi)^3 to the sum of all terms.
+    template <typename T>
+    T relativity_factor(const T &p_final, const T &p_initial, const NN::NN_configs &configs)
     {
-        double nucleon_mass = configs.mass_nucleon;
-        double e_final = sqrt(nucleon_mass * nucleon_mass + p_final * p_final);
-        double e_initial = sqrt(nucleon_mass * nucleon_mass + p_initial * p_initial);
-        double relativity_factor = nucleon_mass / sqrt(e_final * e_initial);
-        double temp = 0.0;
+        using std::sqrt;
+        T nucleon_mass = configs.mass_nucleon;
+        T e_final = sqrt(nucleon_mass * nucleon_mass + p_final * p_final);
+        T e_initial = sqrt(nucleon_mass * nucleon_mass + p_initial * p_initial);
+        return nucleon_mass / sqrt(e_final * e_initial);
+    }
 
-        // contact terms, already partial-wave projected.
+    // contact terms of one channel, already partial-wave projected, without normalization.
+    template <typename T>
+    T potential_contact(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const T &p_final, const T &p_initial, const NN::NN_configs &configs)
+    {
+        T temp = T(0.0);
         // lo terms.
-        temp = temp + interaction_part_contact::potential_contact_lo(l_final, l_initial, s, j, tz, p_final, p_initial, configs);
+        {
+            profiler::scoped_timer timer(profiler::contact_lo);
+            temp = temp + interaction_part_contact::potential_contact_lo(l_final, l_initial, s, j, tz, p_final, p_initial, configs);
+        }
         // nlo terms.
-        temp = temp + interaction_part_contact::potential_contact_nlo(l_final, l_initial, s, j, tz, p_final, p_initial, configs);
+        if (configs.chiral_order_index >= 1)
+        {
+            profiler::scoped_timer timer(profiler::contact_nlo);
+            temp = temp + interaction_part_contact::potential_contact_nlo(l_final, l_initial, s, j, tz, p_final, p_initial, configs);
+        }
         // n2lo terms.
         // there is no n2lo contact terms.
+        return temp;
+    }
 
-        std::vector<double> f_component_vec(6, 0.0); // [f1,f2,f3,f4,f5,f6] vector.
-        double x, w, fa;
-        std::vector<double> one_pion_exchange;
-        std::vector<double> two_pion_exchange_nlo;
-        std::vector<double> two_pion_exchange_n2lo;
+    // pion-exchange terms of one channel up to "chiral_order", without normalization, templated on the scalar type "T"
+    // of the evaluation.
+    // they are projected with the angular rule "angular_points", "angular_weights" in [-1, 1].
+    // the weighted integrand is stored per angle and summed in a fixed order with compensation, so the
+    // result is bit-identical for any number of threads.
+    template <typename T>
+    T potential_pion_exchange(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const T &p_final, const T &p_initial, const NN::NN_configs &configs,
+                              const std::vector<double> &angular_points, const std::vector<double> &angular_weights)
+    {
+        std::vector<T> terms(angular_points.size());
+        std::vector<T> f_component_vec(6, T(0.0)); // [f1,f2,f3,f4,f5,f6] vector.
+        T x;
+        T fa;
+        std::vector<T> one_pion_exchange(6, T(0.0));
+        std::vector<T> two_pion_exchange_nlo(6, T(0.0));
+        std::vector<T> two_pion_exchange_n2lo(6, T(0.0));
+        std::vector<T> two_pion_exchange_n3lo(6, T(0.0));
+        // the analytic one-pion exchange and the spectral two-pion exchange are added by potential_chiral.
+        bool tpe = (configs.tpe_projection != "spectral");
+        bool nlo = tpe && configs.chiral_order_index >= 1;
+        bool n2lo = tpe && configs.chiral_order_index >= 2;
+        bool n3lo = tpe && configs.chiral_order_index >= 3;
+        bool ope = (configs.ope_projection != "analytic");
+        if (!ope && !nlo)
+        {
+            return T(0.0);
+        }
 
-#pragma omp parallel for private(f_component_vec, x, w, fa, one_pion_exchange, two_pion_exchange_nlo, two_pion_exchange_n2lo) reduction(+ : temp) schedule(dynamic)
+#pragma omp parallel for private(f_component_vec, x, fa) firstprivate(one_pion_exchange, two_pion_exchange_nlo, two_pion_exchange_n2lo, two_pion_exchange_n3lo) schedule(dynamic)
         // pion-exchange terms, need to do PWD.
-        for (size_t idx_angle = 0; idx_angle < configs.angular_mesh_number; idx_angle = idx_angle + 1)
+        for (size_t idx_angle = 0; idx_angle < angular_points.size(); idx_angle = idx_angle + 1)
         {
-            f_component_vec = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
-            x = configs.angular_mesh_points[idx_angle]; // x=cos(theta), where theta is the angle between p_final and p_initial.
-            w = configs.angular_mesh_weights[idx_angle];
+            f_component_vec.assign(6, T(0.0));
+            x = angular_points[idx_angle]; // x=cos(theta), where theta is the angle between p_final and p_initial.
 
             // LO one-pion-exchange term.
-            one_pion_exchange = interaction_part_pion_exchange::potential_one_pion_exchange(l_final, l_initial, s, j, tz, p_final, p_initial, x, configs);
+            if (ope)
+            {
+                profiler::scoped_timer timer(profiler::one_pion_exchange);
+                one_pion_exchange = interaction_part_pion_exchange::potential_one_pion_exchange(l_final, l_initial, s, j, tz, p_final, p_initial, x, configs);
+            }
             // NLO two-pion-exchange term.
-            two_pion_exchange_nlo = interaction_part_pion_exchange::potential_two_pion_exchange_nlo(l_final, l_initial, s, j, tz, p_final, p_initial, x, configs);
+            if (nlo)
+            {
+                profiler::scoped_timer timer(profiler::two_pion_exchange_nlo);
+                two_pion_exchange_nlo = interaction_part_pion_exchange::potential_two_pion_exchange_nlo(l_final, l_initial, s, j, tz, p_final, p_initial, x, configs);
+            }
             // N2LO two-pion-exchange term.
-            two_pion_exchange_n2lo = interaction_part_pion_exchange::potential_two_pion_exchange_n2lo(l_final, l_initial, s, j, tz, p_final, p_initial, x, configs);
+            if (n2lo)
+            {
+                profiler::scoped_timer timer(profiler::two_pion_exchange_n2lo);
+                two_pion_exchange_n2lo = interaction_part_pion_exchange::potential_two_pion_exchange_n2lo(l_final, l_initial, s, j, tz, p_final, p_initial, x, configs);
+            }
+            // N3LO two-pion-exchange term.
+            if (n3lo)
+            {
+                profiler::scoped_timer timer(profiler::two_pion_exchange_n3lo);
+                two_pion_exchange_n3lo = interaction_part_pion_exchange::potential_two_pion_exchange_n3lo(l_final, l_initial, s, j, tz, p_final, p_initial, x, configs);
+            }
 
             for (size_t idx_f = 0; idx_f < f_component_vec.size(); idx_f = idx_f + 1)
             {
@@ -56,17 +113,97 @@ namespace interaction_all
                 f_component_vec[idx_f] += two_pion_exchange_nlo[idx_f];
                 // adding n2lo terms.
                 f_component_vec[idx_f] += two_pion_exchange_n2lo[idx_f];
+                // adding n3lo terms.
+                f_component_vec[idx_f] += two_pion_exchange_n3lo[idx_f];
             }
             // perform aPWD after adding up all terms. (independent of tz)
-            fa = interaction_aPWD::potential_auto(l_final, l_initial, s, j, p_final, p_initial, x, f_component_vec);
-            temp = temp + fa * w;
+            {
+                profiler::scoped_timer timer(profiler::apwd_projection);
+                fa = interaction_aPWD::potential_auto(l_final, l_initial, s, j, p_final, p_initial, x, f_component_vec);
+            }
+            terms[idx_angle] = fa * T(angular_weights[idx_angle]);
         }
 
+        return basic_math::neumaier_sum(terms);
+    }
+
+    // pion-exchange terms of one channel projected in closed form instead of by the angular integration of
+    // potential_pion_exchange, without normalization: the one-pion exchange with ope_projection = analytic and the
+    // two-pion exchange with tpe_projection = spectral.
+    template <typename T>
+    T potential_pion_exchange_projected(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const T &p_final, const T &p_initial, const NN::NN_configs &configs)
+    {
+        T temp = T(0.0);
+        if (configs.ope_projection == "analytic")
+        {
+            profiler::scoped_timer timer(profiler::one_pion_exchange);
+            temp = temp + ope_projection::potential(l_final, l_initial, s, j, tz, p_final, p_initial, configs);
+        }
+        if (configs.tpe_projection == "spectral" && configs.chiral_order_index >= 1)
+        {
+            profiler::scoped_timer timer(profiler::two_pion_exchange_nlo);
+            temp = temp + tpe_projection::potential(l_final, l_initial, s, j, tz, p_final, p_initial, configs);
+        }
+        return temp;
+    }
+
+    // chiral potential of one channel, templated on the scalar type "T" of the evaluation.
+    // the pion-exchange terms are projected with the angular rule "angular_points", "angular_weights" in [-1, 1].
+    template <typename T>
+    T potential_chiral(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const T &p_final, const T &p_initial, const NN::NN_configs &configs,
+                       const std::vector<double> &angular_points, const std::vector<double> &angular_weights)
+    {
+        profiler::scoped_timer timer_element(profiler::matrix_element);
+        T temp = potential_contact<T>(l_final, l_initial, s, j, tz, p_final, p_initial, configs);
+        temp = temp + potential_pion_exchange<T>(l_final, l_initial, s, j, tz, p_final, p_initial, configs, angular_points, angular_weights);
+        temp = temp + potential_pion_exchange_projected<T>(l_final, l_initial, s, j, tz, p_final, p_initial, configs);
+
         // apply a relativity-factor and a normalization constant (2Pi)^3.
-        temp = temp * relativity_factor / twopicubic;
+        temp = temp * relativity_factor(p_final, p_initial, configs) / T(twopicubic);
         return temp;
     }
 
+    // chiral potential with the fixed angular mesh of "angular_mesh_number" points.
+    template <typename T>
+    T potential_chiral(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const T &p_final, const T &p_initial, const NN::NN_configs &configs)
+    {
+        return potential_chiral<T>(l_final, l_initial, s, j, tz, p_final, p_initial, configs, configs.angular_mesh_points, configs.angular_mesh_weights);
+    }
+
+    // matrix element in the precision selected by "precision" in [numerical-parameters], with the angular rule "angular_points", "angular_weights".
+    double potential_element(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const double &p_final, const double &p_initial, const NN::NN_configs &configs,
+                             const std::vector<double> &angular_points, const std::vector<double> &angular_weights)
+    {
+        if (configs.precision == "float")
+        {
+            return potential_chiral<float>(l_final, l_initial, s, j, tz, p_final, p_initial, configs, angular_points, angular_weights);
+        }
+        return potential_chiral<double>(l_final, l_initial, s, j, tz, p_final, p_initial, configs, angular_points, angular_weights);
+    }
+
+    // matrix element with the fixed angular mesh.
+    double potential_element(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const double &p_final, const double &p_initial, const NN::NN_configs &configs)
+    {
+        return potential_element(l_final, l_initial, s, j, tz, p_final, p_initial, configs, configs.angular_mesh_points, configs.angular_mesh_weights);
+    }
+
+    // full matrix V(p'_i, p_k) of one channel [l', l, s, j, tz] on the momentum mesh, row-major.
+    template <typename T = double>
+    std::vector<double> potential_matrix(const std::vector<int> &this_channel, const NN::NN_configs &configs)
+    {
+        size_t n = configs.mesh_points_number;
+        std::vector<double> v(n * n);
+        for (size_t idx_mom_bra = 0; idx_mom_bra < n; idx_mom_bra = idx_mom_bra + 1)
+        {
+            for (size_t idx_mom_ket = 0; idx_mom_ket < n; idx_mom_ket = idx_mom_ket + 1)
+            {
+                v[idx_mom_bra * n + idx_mom_ket] = potential_chiral<T>(this_channel[0], this_channel[1], this_channel[2], this_channel[3], this_channel[4],
+                                                                          T(configs.momentum_mesh_points[idx_mom_bra]), T(configs.momentum_mesh_points[idx_mom_ket]), configs);
+            }
+        }
+        return v;
+    }
+
 } // namespace interaction_all
 
 #endif // ALL_INTERACTION_HPP
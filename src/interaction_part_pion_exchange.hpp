@@ -3,6 +3,7 @@
 #define INTERACTION_PART_PE_HPP
 
 #include "interaction_aPWD.hpp"
+#include "spectral_tables.hpp"
 #include "lib_define.hpp"
 
 namespace interaction_part_pion_exchange
@@ -20,38 +21,41 @@ namespace interaction_part_pion_exchange
     }
 
     // LO one-pion exchange potential.
-    std::vector<double> potential_one_pion_exchange(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const double &p_final, const double &p_initial, const double &x, const NN::NN_configs &configs)
+    template <typename T>
+    std::vector<T> potential_one_pion_exchange(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const T &p_final, const T &p_initial, const T &x, const NN::NN_configs &configs)
     {
-        std::vector<double> f(6, 0.0); // [f1,f2,f3,f4,f5,f6] vector.
+        std::vector<T> f(6, T(0.0)); // [f1,f2,f3,f4,f5,f6] vector.
         double regulator_power = configs.n_reg_one_pion_exchange;
 
-        double ga = configs.axial_current_coupling_constant;
-        double gaga = ga * ga;
-        double fpi = configs.pion_decay_constant;
-        double ff = fpi * fpi;
-        double frefactor = -gaga / 4.0 / ff;
+        T ga = interaction_aPWD::parameter<T>(configs.axial_current_coupling_constant, dual_numbers::ga, configs);
+        T gaga = ga * ga;
+        T fpi = interaction_aPWD::parameter<T>(configs.pion_decay_constant, dual_numbers::fpi, configs);
+        T ff = fpi * fpi;
+        T frefactor = -gaga / T(4.0) / ff;
 
-        double pmag = p_initial;
-        double ppmag = p_final;
-        double regulator = interaction_aPWD::regulator_function(pmag, ppmag, regulator_power, configs);
+        T pmag = p_initial;
+        T ppmag = p_final;
+        T regulator = interaction_aPWD::regulator_function(pmag, ppmag, regulator_power, configs);
 
-        double f1 = 0.0;
-        double f2 = 0.0;
-        double f3 = 0.0;
-        double f4 = 0.0;
-        double f5 = 0.0;
-        double f6 = 0.0;
+        T f1 = T(0.0);
+        T f2 = T(0.0);
+        T f3 = T(0.0);
+        T f4 = T(0.0);
+        T f5 = T(0.0);
+        T f6 = T(0.0);
 
-        double f6_ope_neutral = frefactor / (pmag * pmag + ppmag * ppmag - 2.0 * pmag * ppmag * x +
-                                             configs.mass_pion_neutral * configs.mass_pion_neutral);
-        double f6_ope_charged = frefactor / (pmag * pmag + ppmag * ppmag - 2.0 * pmag * ppmag * x +
-                                             configs.mass_pion_charged * configs.mass_pion_charged);
+        auto mpi_neutral = interaction_aPWD::parameter<T>(configs.mass_pion_neutral, dual_numbers::mpi_neutral, configs);
+        auto mpi_charged = interaction_aPWD::parameter<T>(configs.mass_pion_charged, dual_numbers::mpi_charged, configs);
+        T f6_ope_neutral = frefactor / (pmag * pmag + ppmag * ppmag - T(2.0) * pmag * ppmag * x +
+                                        T(mpi_neutral) * T(mpi_neutral));
+        T f6_ope_charged = frefactor / (pmag * pmag + ppmag * ppmag - T(2.0) * pmag * ppmag * x +
+                                        T(mpi_charged) * T(mpi_charged));
 
         if (tz == 0)
         {
             // for np channel, taking into account CIB effect.
-            double f6_ope_I0 = -f6_ope_neutral - 2.0 * f6_ope_charged;
-            double f6_ope_I1 = -f6_ope_neutral + 2.0 * f6_ope_charged;
+            T f6_ope_I0 = -f6_ope_neutral - T(2.0) * f6_ope_charged;
+            T f6_ope_I1 = -f6_ope_neutral + T(2.0) * f6_ope_charged;
             if ((l_initial + s) % 2 == 0)
             {
                 // total isospin I=1.
@@ -83,40 +87,43 @@ namespace interaction_part_pion_exchange
     }
 
     // NLO two-pion exchange potential.
-    std::vector<double> potential_two_pion_exchange_nlo(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const double &p_final, const double &p_initial, const double &x, const NN::NN_configs &configs)
+    template <typename T>
+    std::vector<T> potential_two_pion_exchange_nlo(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const T &p_final, const T &p_initial, const T &x, const NN::NN_configs &configs)
     {
-        std::vector<double> f(6, 0.0); // [f1,f2,f3,f4,f5,f6] vector.
+        std::vector<T> f(6, T(0.0)); // [f1,f2,f3,f4,f5,f6] vector.
         double regulator_power = configs.n_reg_two_pion_exchange_nlo;
+        using std::pow, std::sqrt;
 
-        double ga = configs.axial_current_coupling_constant;
-        double gaga = ga * ga;
-        double gagagaga = gaga * gaga;
-        double fpi = configs.pion_decay_constant;
-        double ff = fpi * fpi;
-        double ffff = ff * ff;
-        double mpi2 = pow(configs.mass_pion_averaged, 2);
-        double mpi4 = pow(configs.mass_pion_averaged, 4);
-
-        double pmag = p_initial;
-        double ppmag = p_final;
-        double q2 = ppmag * ppmag + pmag * pmag - 2.0 * ppmag * pmag * x;
-        double qmag = sqrt(q2);
-        double regulator = interaction_aPWD::regulator_function(pmag, ppmag, regulator_power, configs);
-        double isospin_factor = get_isospin_factor(l_final, l_initial, s, j, tz);
-
-        double f1 = 0.0;
-        double f2 = 0.0;
-        double f3 = 0.0;
-        double f4 = 0.0;
-        double f5 = 0.0;
-        double f6 = 0.0;
-
-        double f1_fac = interaction_aPWD::loop_function_L(qmag, configs) / (384.0 * PI * PI * ffff);
-        double f1_part1 = 4.0 * mpi2 * (1.0 + 4.0 * gaga - 5.0 * gagagaga);
-        double f1_part2 = qmag * qmag * (1.0 + 10.0 * gaga - 23.0 * gagagaga);
-        double f1_part3 = -48.0 * gagagaga * mpi4 / (4.0 * mpi2 + qmag * qmag);
+        T ga = interaction_aPWD::parameter<T>(configs.axial_current_coupling_constant, dual_numbers::ga, configs);
+        T gaga = ga * ga;
+        T gagagaga = gaga * gaga;
+        T fpi = interaction_aPWD::parameter<T>(configs.pion_decay_constant, dual_numbers::fpi, configs);
+        T ff = fpi * fpi;
+        T ffff = ff * ff;
+        auto mpi = interaction_aPWD::parameter<T>(configs.mass_pion_averaged, dual_numbers::mpi_averaged, configs);
+        T mpi2 = pow(mpi, 2);
+        T mpi4 = pow(mpi, 4);
+
+        T pmag = p_initial;
+        T ppmag = p_final;
+        T q2 = ppmag * ppmag + pmag * pmag - T(2.0) * ppmag * pmag * x;
+        T qmag = sqrt(q2);
+        T regulator = interaction_aPWD::regulator_function(pmag, ppmag, regulator_power, configs);
+        T isospin_factor = get_isospin_factor(l_final, l_initial, s, j, tz);
+
+        T f1 = T(0.0);
+        T f2 = T(0.0);
+        T f3 = T(0.0);
+        T f4 = T(0.0);
+        T f5 = T(0.0);
+        T f6 = T(0.0);
+
+        T f1_fac = interaction_aPWD::loop_function_L(qmag, configs) / (T(384.0) * T(PI) * T(PI) * ffff);
+        T f1_part1 = T(4.0) * mpi2 * (T(1.0) + T(4.0) * gaga - T(5.0) * gagagaga);
+        T f1_part2 = qmag * qmag * (T(1.0) + T(10.0) * gaga - T(23.0) * gagagaga);
+        T f1_part3 = -T(48.0) * gagagaga * mpi4 / (T(4.0) * mpi2 + qmag * qmag);
         f1 = isospin_factor * f1_fac * (f1_part1 + f1_part2 + f1_part3);
-        f6 = -3.0 * gagagaga / (64.0 * PI * PI * ffff) * interaction_aPWD::loop_function_L(qmag, configs);
+        f6 = -T(3.0) * gagagaga / (T(64.0) * T(PI) * T(PI) * ffff) * interaction_aPWD::loop_function_L(qmag, configs);
         f2 = -qmag * qmag * f6;
 
         f[0] = f1;
@@ -133,38 +140,41 @@ namespace interaction_part_pion_exchange
     }
 
     // N2LO two-pion exchange potential.
-    std::vector<double> potential_two_pion_exchange_n2lo(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const double &p_final, const double &p_initial, const double &x, const NN::NN_configs &configs)
+    template <typename T>
+    std::vector<T> potential_two_pion_exchange_n2lo(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const T &p_final, const T &p_initial, const T &x, const NN::NN_configs &configs)
     {
-        std::vector<double> f(6, 0.0); // [f1,f2,f3,f4,f5,f6] vector.
+        std::vector<T> f(6, T(0.0)); // [f1,f2,f3,f4,f5,f6] vector.
         double regulator_power = configs.n_reg_two_pion_exchange_n2lo;
+        using std::pow, std::sqrt;
+
+        T ga = interaction_aPWD::parameter<T>(configs.axial_current_coupling_constant, dual_numbers::ga, configs);
+        T gaga = ga * ga;
+        T fpi = interaction_aPWD::parameter<T>(configs.pion_decay_constant, dual_numbers::fpi, configs);
+        T ff = fpi * fpi;
+        T ffff = ff * ff;
+        auto mpi = interaction_aPWD::parameter<T>(configs.mass_pion_averaged, dual_numbers::mpi_averaged, configs);
+        T mpi2 = pow(mpi, 2);
 
-        double ga = configs.axial_current_coupling_constant;
-        double gaga = ga * ga;
-        double fpi = configs.pion_decay_constant;
-        double ff = fpi * fpi;
-        double ffff = ff * ff;
-        double mpi2 = pow(configs.mass_pion_averaged, 2);
-
-        double pmag = p_initial;
-        double ppmag = p_final;
-        double q2 = ppmag * ppmag + pmag * pmag - 2.0 * ppmag * pmag * x;
-        double qmag = sqrt(q2);
-        double regulator = interaction_aPWD::regulator_function(pmag, ppmag, regulator_power, configs);
-        double isospin_factor = get_isospin_factor(l_final, l_initial, s, j, tz);
-
-        double f1 = 0.0;
-        double f2 = 0.0;
-        double f3 = 0.0;
-        double f4 = 0.0;
-        double f5 = 0.0;
-        double f6 = 0.0;
-
-        double f1_part1 = 3.0 * gaga / (16.0 * PI * ffff);
-        double f1_part2 = 2.0 * mpi2 * (configs.c3 - 2.0 * configs.c1) + configs.c3 * qmag * qmag;
-        double f1_part3 = 2.0 * mpi2 + qmag * qmag;
-        double f1_part4 = interaction_aPWD::loop_function_A(qmag, configs);
+        T pmag = p_initial;
+        T ppmag = p_final;
+        T q2 = ppmag * ppmag + pmag * pmag - T(2.0) * ppmag * pmag * x;
+        T qmag = sqrt(q2);
+        T regulator = interaction_aPWD::regulator_function(pmag, ppmag, regulator_power, configs);
+        T isospin_factor = get_isospin_factor(l_final, l_initial, s, j, tz);
+
+        T f1 = T(0.0);
+        T f2 = T(0.0);
+        T f3 = T(0.0);
+        T f4 = T(0.0);
+        T f5 = T(0.0);
+        T f6 = T(0.0);
+
+        T f1_part1 = T(3.0) * gaga / (T(16.0) * T(PI) * ffff);
+        T f1_part2 = T(2.0) * mpi2 * (T(configs.c3) - T(2.0) * T(configs.c1)) + T(configs.c3) * qmag * qmag;
+        T f1_part3 = T(2.0) * mpi2 + qmag * qmag;
+        T f1_part4 = interaction_aPWD::loop_function_A(qmag, configs);
         f1 = f1_part1 * f1_part2 * f1_part3 * f1_part4;
-        f6 = -isospin_factor * gaga / (32.0 * PI * ffff) * configs.c4 * (4.0 * mpi2 + qmag * qmag) *
+        f6 = -isospin_factor * gaga / (T(32.0) * T(PI) * ffff) * T(configs.c4) * (T(4.0) * mpi2 + qmag * qmag) *
              interaction_aPWD::loop_function_A(qmag, configs);
         f2 = -qmag * qmag * f6;
 
@@ -181,6 +191,71 @@ namespace interaction_part_pion_exchange
         return f;
     }
 
+    // N3LO two-pion exchange potential, leading order in 1/M_N: the one-loop football diagram with two c_i vertices
+    // in closed form and the two-loop terms from the spectral tables of configs.
+    template <typename T>
+    std::vector<T> potential_two_pion_exchange_n3lo(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const T &p_final, const T &p_initial, const T &x, const NN::NN_configs &configs)
+    {
+        std::vector<T> f(6, T(0.0)); // [f1,f2,f3,f4,f5,f6] vector.
+        double regulator_power = configs.n_reg_two_pion_exchange_n3lo;
+        using std::pow, std::sqrt;
+        const auto &table = configs.two_pion_exchange_n3lo_table;
+
+        T fpi = interaction_aPWD::parameter<T>(configs.pion_decay_constant, dual_numbers::fpi, configs);
+        T ff = fpi * fpi;
+        T ffff = ff * ff;
+        auto mpi = interaction_aPWD::parameter<T>(configs.mass_pion_averaged, dual_numbers::mpi_averaged, configs);
+        T mpi2 = pow(mpi, 2);
+        T c1 = configs.c1;
+        T c2 = configs.c2;
+        T c3 = configs.c3;
+        T c4 = configs.c4;
+
+        T pmag = p_initial;
+        T ppmag = p_final;
+        T q2 = ppmag * ppmag + pmag * pmag - T(2.0) * ppmag * pmag * x;
+        T qmag = sqrt(q2);
+        T w2 = T(4.0) * mpi2 + q2;
+        T regulator = interaction_aPWD::regulator_function(pmag, ppmag, regulator_power, configs);
+        T isospin_factor = get_isospin_factor(l_final, l_initial, s, j, tz);
+
+        T f1 = T(0.0);
+        T f2 = T(0.0);
+        T f3 = T(0.0);
+        T f4 = T(0.0);
+        T f5 = T(0.0);
+        T f6 = T(0.0);
+
+        // football diagram.
+        T loop_l = interaction_aPWD::loop_function_L(qmag, configs);
+        T vc_part1 = c2 / T(6.0) * w2 + c3 * (T(2.0) * mpi2 + q2) - T(4.0) * c1 * mpi2;
+        T vc_part2 = c2 * c2 / T(45.0) * w2 * w2;
+        T vc_football = T(3.0) / (T(16.0) * T(PI) * T(PI) * ffff) * loop_l * (vc_part1 * vc_part1 + vc_part2);
+        T wt_football = c4 * c4 / (T(96.0) * T(PI) * T(PI) * ffff) * w2 * loop_l;
+
+        // two-loop terms.
+        T vc_two_loop = spectral_tables::central(table, spectral_tables::v_c, qmag);
+        T wc_two_loop = spectral_tables::central(table, spectral_tables::w_c, qmag);
+        T vt_two_loop = spectral_tables::tensor(table, spectral_tables::v_t, qmag);
+        T wt_two_loop = spectral_tables::tensor(table, spectral_tables::w_t, qmag);
+
+        f1 = vc_football + vc_two_loop + isospin_factor * wc_two_loop;
+        f6 = vt_two_loop + isospin_factor * (wt_football + wt_two_loop);
+        f2 = -qmag * qmag * f6;
+
+        f[0] = f1;
+        f[1] = f2;
+        f[2] = f3;
+        f[3] = f4;
+        f[4] = f5;
+        f[5] = f6;
+        for (auto &component : f)
+        {
+            component *= regulator;
+        }
+        return f;
+    }
+
 } // end namespace interaction_part_pion_exchange
 
 #endif // INTERACTION_PART_PE_HPP
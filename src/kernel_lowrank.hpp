@@ -0,0 +1,258 @@
+#pragma once
+#ifndef KERNEL_LOWRANK_HPP
+#define KERNEL_LOWRANK_HPP
+
+#include "linear_algebra.hpp"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// kernels stored as truncated factors, switched on by "compression = lowrank" in [output]. a regulated kernel is
+// smooth, and its n x n matrix is numerically of low rank r. it is factorized as
+//     V ~ U diag(s) Vt,     (U: n x r, Vt: r x n)
+// or, if V(p', p) is symmetric, as V ~ U diag(s) U^T with the eigenvalues s, and the factors take O(n r) memory
+// and apply to a vector in O(n r). the factorization is a pivoted qr, V ~ Q R, cut well below the tolerance, followed
+// by a jacobi svd of R, or by the jacobi eigenvalues of Q^T V Q for a symmetric V. the terms below "tolerance" times
+// the largest singular value (or eigenvalue) are dropped, so the spectral-norm error is about that.
+// this header only depends on linear_algebra.hpp and can be included by consumers.
+//
+// file: header, then s (rank doubles), U (dim x rank, row-major) and, if not symmetric, Vt (rank x dim, row-major).
+namespace kernel_lowrank
+{
+    constexpr char magic[8] = "NNCMSLR";
+    constexpr uint32_t format_version = 1;
+
+    struct header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t symmetric;
+        uint64_t dim;
+        uint64_t rank;
+    };
+
+    // truncated factors of a dim x dim matrix.
+    struct factors
+    {
+        size_t dim = 0;
+        size_t rank = 0;
+        bool symmetric = false;
+        std::vector<double> s;  // singular values or eigenvalues.
+        std::vector<double> u;  // dim x rank.
+        std::vector<double> vt; // rank x dim, empty if symmetric.
+
+        // values held by the factors.
+        size_t stored_values() const
+        {
+            return s.size() + u.size() + vt.size();
+        }
+
+        // y = V x of "columns" vectors, x and y are dim x columns, row-major.
+        std::vector<double> apply(const std::vector<double> &x, size_t columns = 1) const
+        {
+            std::vector<double> projected(rank * columns, 0.0), y;
+            if (symmetric)
+            {
+                // U^T x, the rows of U are contiguous.
+                for (size_t i = 0; i < dim; i = i + 1)
+                {
+                    for (size_t k = 0; k < rank; k = k + 1)
+                    {
+                        double u_ik = u[i * rank + k];
+                        for (size_t c = 0; c < columns; c = c + 1)
+                        {
+                            projected[k * columns + c] += u_ik * x[i * columns + c];
+                        }
+                    }
+                }
+            }
+            else
+            {
+                linear_algebra::multiply(vt, x, projected, rank, dim, columns);
+            }
+            for (size_t k = 0; k < rank; k = k + 1)
+            {
+                for (size_t c = 0; c < columns; c = c + 1)
+                {
+                    projected[k * columns + c] *= s[k];
+                }
+            }
+            linear_algebra::multiply(u, projected, y, dim, rank, columns);
+            return y;
+        }
+
+        // the full dim x dim matrix, row-major.
+        std::vector<double> reconstruct() const
+        {
+            std::vector<double> scaled(rank * dim), v;
+            for (size_t k = 0; k < rank; k = k + 1)
+            {
+                for (size_t j = 0; j < dim; j = j + 1)
+                {
+                    scaled[k * dim + j] = s[k] * (symmetric ? u[j * rank + k] : vt[k * dim + j]);
+                }
+            }
+            linear_algebra::multiply(u, scaled, v, dim, rank, dim);
+            return v;
+        }
+    };
+
+    // the pivoted qr keeps the columns above this fraction of the tolerance, so that the truncation is decided by the
+    // singular values or eigenvalues.
+    constexpr double qr_margin = 1e-2;
+
+    // factors of the row-major dim x dim matrix "a" without the terms below "tolerance" times the largest one.
+    // the matrix is treated as symmetric if it is up to "tolerance" times its largest element.
+    factors compress(const std::vector<double> &a, size_t dim, double tolerance)
+    {
+        factors f;
+        f.dim = dim;
+        double peak = 0.0, asymmetry = 0.0;
+        for (size_t i = 0; i < dim; i = i + 1)
+        {
+            for (size_t j = 0; j < dim; j = j + 1)
+            {
+                peak = std::max(peak, std::fabs(a[i * dim + j]));
+                asymmetry = std::max(asymmetry, std::fabs(a[i * dim + j] - a[j * dim + i]));
+            }
+        }
+        f.symmetric = asymmetry <= tolerance * peak;
+        if (peak == 0.0)
+        {
+            return f;
+        }
+
+        // a ~ q r, the largest element is at most the largest singular value.
+        std::vector<double> q, r;
+        size_t k = linear_algebra::pivoted_qr(a, dim, dim, qr_margin * tolerance * peak, q, r);
+
+        std::vector<double> s, basis, vt;
+        if (f.symmetric)
+        {
+            // q^T a q = z diag(s) z^T and a ~ (q z) diag(s) (q z)^T, with the symmetric part of a.
+            std::vector<double> symmetric_a(dim * dim), aq, c(k * k, 0.0), z;
+            for (size_t i = 0; i < dim; i = i + 1)
+            {
+                for (size_t j = 0; j < dim; j = j + 1)
+                {
+                    symmetric_a[i * dim + j] = 0.5 * (a[i * dim + j] + a[j * dim + i]);
+                }
+            }
+            linear_algebra::multiply(symmetric_a, q, aq, dim, dim, k);
+            for (size_t i = 0; i < dim; i = i + 1)
+            {
+                for (size_t m = 0; m < k; m = m + 1)
+                {
+                    for (size_t l = 0; l < k; l = l + 1)
+                    {
+                        c[m * k + l] += q[i * k + m] * aq[i * k + l];
+                    }
+                }
+            }
+            for (size_t m = 0; m < k; m = m + 1)
+            {
+                for (size_t l = m + 1; l < k; l = l + 1)
+                {
+                    c[m * k + l] = c[l * k + m] = 0.5 * (c[m * k + l] + c[l * k + m]);
+                }
+            }
+            linear_algebra::jacobi_eigen(c, k, s, z);
+            linear_algebra::multiply(q, z, basis, dim, k, k);
+        }
+        else
+        {
+            // r = g^T diag(s) vt and a ~ (q g^T) diag(s) vt.
+            std::vector<double> g, g_transposed(k * k);
+            vt = r;
+            linear_algebra::jacobi_svd(vt, k, dim, s, g);
+            for (size_t m = 0; m < k; m = m + 1)
+            {
+                for (size_t l = 0; l < k; l = l + 1)
+                {
+                    g_transposed[l * k + m] = g[m * k + l];
+                }
+            }
+            linear_algebra::multiply(q, g_transposed, basis, dim, k, k);
+        }
+
+        // the terms above the tolerance, by decreasing magnitude.
+        std::vector<size_t> order(k);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&s](size_t x, size_t y)
+                  { return std::fabs(s[x]) > std::fabs(s[y]); });
+        double largest = k > 0 ? std::fabs(s[order[0]]) : 0.0;
+        while (!order.empty() && std::fabs(s[order.back()]) <= tolerance * largest)
+        {
+            order.pop_back();
+        }
+        f.rank = order.size();
+        f.s.resize(f.rank);
+        f.u.resize(dim * f.rank);
+        f.vt.resize(f.symmetric ? 0 : f.rank * dim);
+        for (size_t m = 0; m < f.rank; m = m + 1)
+        {
+            f.s[m] = s[order[m]];
+            for (size_t i = 0; i < dim; i = i + 1)
+            {
+                f.u[i * f.rank + m] = basis[i * k + order[m]];
+            }
+            if (!f.symmetric)
+            {
+                std::copy(vt.begin() + order[m] * dim, vt.begin() + (order[m] + 1) * dim, f.vt.begin() + m * dim);
+            }
+        }
+        return f;
+    }
+
+    // write the factors to "fname", returns an error message or an empty string.
+    std::string write(const std::string &fname, const factors &f)
+    {
+        std::ofstream fp(fname, std::ios::binary);
+        if (!fp.is_open())
+        {
+            return "failed to open file: " + fname;
+        }
+        header h{};
+        std::memcpy(h.magic, magic, sizeof(magic));
+        h.version = format_version;
+        h.symmetric = f.symmetric ? 1 : 0;
+        h.dim = f.dim;
+        h.rank = f.rank;
+        fp.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        fp.write(reinterpret_cast<const char *>(f.s.data()), f.s.size() * sizeof(double));
+        fp.write(reinterpret_cast<const char *>(f.u.data()), f.u.size() * sizeof(double));
+        fp.write(reinterpret_cast<const char *>(f.vt.data()), f.vt.size() * sizeof(double));
+        return fp ? "" : "failed to write file: " + fname;
+    }
+
+    // read the factors of "fname" into "f", returns an error message or an empty string.
+    std::string read(const std::string &fname, factors &f)
+    {
+        std::ifstream fp(fname, std::ios::binary);
+        header h{};
+        if (!fp.read(reinterpret_cast<char *>(&h), sizeof(h)))
+        {
+            return "cannot read low-rank kernel: " + fname;
+        }
+        if (std::memcmp(h.magic, magic, sizeof(magic)) != 0 || h.version != format_version)
+        {
+            return "not a low-rank kernel of format version " + std::to_string(format_version) + ": " + fname;
+        }
+        f.dim = h.dim;
+        f.rank = h.rank;
+        f.symmetric = h.symmetric != 0;
+        f.s.resize(f.rank);
+        f.u.resize(f.dim * f.rank);
+        f.vt.resize(f.symmetric ? 0 : f.rank * f.dim);
+        fp.read(reinterpret_cast<char *>(f.s.data()), f.s.size() * sizeof(double));
+        fp.read(reinterpret_cast<char *>(f.u.data()), f.u.size() * sizeof(double));
+        fp.read(reinterpret_cast<char *>(f.vt.data()), f.vt.size() * sizeof(double));
+        return fp ? "" : "truncated low-rank kernel: " + fname;
+    }
+
+} // namespace kernel_lowrank
+
+#endif // KERNEL_LOWRANK_HPP
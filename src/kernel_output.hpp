@@ -0,0 +1,834 @@
+#pragma once
+#ifndef KERNEL_OUTPUT_HPP
+#define KERNEL_OUTPUT_HPP
+
+#include "angular_quadrature.hpp"
+#include "interaction_all.hpp"
+#include "kernel_lowrank.hpp"
+#include "kernel_store.hpp"
+#include "lib_define.hpp"
+#include "screening.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+// writing the partial-wave kernels, momentum mesh and channel list to files.
+namespace kernel_output
+{
+    // pack the readable file "txtfname" to binary file "binfname",
+    // they have the same number of values, stored as "value_type" in the binary file.
+    template <typename value_type = double>
+    void pack_kernel_file(const std::string &txtfname, const std::string &binfname, const size_t num)
+    {
+        std::ifstream fp_txt(txtfname);
+        if (!fp_txt.is_open())
+        {
+            std::cerr << "failed to open interaction file: " << txtfname << std::endl;
+        }
+        std::ofstream fp_bin(binfname, std::ios::binary);
+        for (size_t i = 0; i < num; i = i + 1)
+        {
+            double value;
+            fp_txt >> value;
+            value_type stored = static_cast<value_type>(value);
+            fp_bin.write(reinterpret_cast<const char *>(&stored), sizeof(value_type));
+        }
+        fp_txt.close();
+        fp_bin.close();
+    }
+
+    // isospin-projection name used in file names.
+    std::string tz_name(int tz)
+    {
+        if (tz == -1)
+        {
+            return "pp";
+        }
+        else if (tz == 0)
+        {
+            return "np";
+        }
+        else if (tz == 1)
+        {
+            return "nn";
+        }
+        return "???";
+    }
+
+    // channel tag "l'-l-s-j-tzname" used in file names and reports.
+    std::string channel_tag(const std::vector<int> &this_channel)
+    {
+        std::ostringstream oss;
+        oss << this_channel[0] << "-" << this_channel[1] << "-" << this_channel[2] << "-" << this_channel[3] << "-" << tz_name(this_channel[4]);
+        return oss.str();
+    }
+
+    // kernel file tag of the coupled block that starts with channel [j-1, j-1, 1, j, tz], "coupled-j-tzname".
+    std::string coupled_tag(const std::vector<int> &this_channel)
+    {
+        std::ostringstream oss;
+        oss << "coupled-" << this_channel[3] << "-" << tz_name(this_channel[4]);
+        return oss.str();
+    }
+
+    // true if channels[idx] starts the four channels [j-1, j-1], [j-1, j+1], [j+1, j-1], [j+1, j+1] of a coupled
+    // (j, tz), in the order they are read from one line of the coupled table.
+    bool coupled_group(const std::vector<std::vector<int>> &channels, size_t idx)
+    {
+        if (idx + 3 >= channels.size())
+        {
+            return false;
+        }
+        int j = channels[idx][3];
+        int tz = channels[idx][4];
+        std::vector<std::vector<int>> group = {{j - 1, j - 1, 1, j, tz}, {j - 1, j + 1, 1, j, tz}, {j + 1, j - 1, 1, j, tz}, {j + 1, j + 1, 1, j, tz}};
+        return std::equal(group.begin(), group.end(), channels.begin() + idx);
+    }
+
+    // the layout of the original code: one row-major file per channel, without weights.
+    bool default_layout(const NN::NN_configs &configs)
+    {
+        return configs.coupled_layout == "separate" && configs.matrix_order == "row" && !configs.weight_folding && configs.compression == "none";
+    }
+
+    // factor p'_i p_k sqrt(w'_i w_k) that turns V(p'_i, p_k) into the kernel of the lippmann-schwinger equation.
+    double fold_factor(const NN::NN_configs &configs, size_t idx_mom_bra, size_t idx_mom_ket)
+    {
+        const auto &p = configs.momentum_mesh_points;
+        const auto &w = configs.momentum_mesh_weights;
+        return p[idx_mom_bra] * p[idx_mom_ket] * std::sqrt(w[idx_mom_bra] * w[idx_mom_ket]);
+    }
+
+    // write the matrix "v" of "dim" x "dim" values, in file order, to the txt file of "tag" and pack it to the binary file.
+    void write_matrix_files(const std::string &tag, const NN::NN_configs &configs, const std::vector<double> &v, size_t dim)
+    {
+        // write txt file for this partial-wave channel.
+        std::ostringstream oss_txt;
+        oss_txt << configs.result_dir << "kernel-" << configs.result_name << "-" << tag << ".txt";
+        auto file_txt_name_this_channel = oss_txt.str();
+        std::cout << "writing: " << file_txt_name_this_channel << std::endl;
+        std::ofstream fp(file_txt_name_this_channel);
+        if (!fp.is_open())
+        {
+            std::cerr << "failed to open file: " << file_txt_name_this_channel << "!\n";
+            exit(-1);
+        }
+        for (size_t idx_mom_bra = 0; idx_mom_bra < dim; idx_mom_bra = idx_mom_bra + 1)
+        {
+            profiler::scoped_timer timer(profiler::text_formatting);
+            for (size_t idx_mom_ket = 0; idx_mom_ket < dim; idx_mom_ket = idx_mom_ket + 1)
+            {
+                fp << std::fixed << " " << std::scientific << std::setprecision(17) << v[idx_mom_bra * dim + idx_mom_ket];
+            }
+            fp << "\n";
+        }
+        fp.close();
+
+        // pack binary file from txt file.
+        std::ostringstream oss_bin;
+        oss_bin << configs.result_dir << "kernel-" << configs.result_name << "-" << tag << (configs.binary_precision == "float" ? ".f32.bin" : ".bin");
+        auto file_bin_name_this_channel = oss_bin.str();
+        {
+            profiler::scoped_timer timer(profiler::binary_packing);
+            if (configs.binary_precision == "float")
+            {
+                pack_kernel_file<float>(file_txt_name_this_channel, file_bin_name_this_channel, dim * dim);
+            }
+            else
+            {
+                pack_kernel_file<double>(file_txt_name_this_channel, file_bin_name_this_channel, dim * dim);
+            }
+        }
+        std::cout << "writing: " << file_bin_name_this_channel << std::endl;
+    }
+
+    // write the low-rank factors of the row-major matrix "v" of "dim" x "dim" values to the file of "tag", returns them.
+    kernel_lowrank::factors write_lowrank_file(const std::string &tag, const NN::NN_configs &configs, const std::vector<double> &v, size_t dim)
+    {
+        kernel_lowrank::factors f;
+        {
+            profiler::scoped_timer timer(profiler::binary_packing);
+            f = kernel_lowrank::compress(v, dim, configs.compression_tolerance);
+        }
+        std::string fname = configs.result_dir + "kernel-" + configs.result_name + "-" + tag + ".lowrank.bin";
+        auto error = kernel_lowrank::write(fname, f);
+        if (!error.empty())
+        {
+            std::cerr << error << std::endl;
+            exit(-1);
+        }
+        std::cout << "writing: " << fname << " (rank " << f.rank << (f.symmetric ? ", symmetric" : "") << ")" << std::endl;
+        return f;
+    }
+
+    // write the matrix "v" (row-major) of one channel to its txt file and pack it to the binary file.
+    void write_kernel_files(const std::vector<int> &this_channel, const NN::NN_configs &configs, const std::vector<double> &v)
+    {
+        write_matrix_files(channel_tag(this_channel), configs, v, configs.mesh_points_number);
+    }
+
+    // compute the matrix of one channel, row-major. the blocks screened by "screen" are zeros.
+    std::vector<double> compute_channel(const std::vector<int> &this_channel, const NN::NN_configs &configs, const screening::plan *screen = nullptr)
+    {
+        int l_final, l_initial, s, j, tz;
+        l_final = this_channel[0];
+        l_initial = this_channel[1];
+        s = this_channel[2];
+        j = this_channel[3];
+        tz = this_channel[4];
+
+        size_t n = configs.mesh_points_number;
+        std::vector<double> v(n * n, 0.0);
+        if (screen != nullptr && screen->skip_channel)
+        {
+            return v;
+        }
+
+        // angular orders of this channel in the adaptive mode.
+        bool adaptive = (configs.angular_mode == "adaptive");
+        angular_quadrature::plan angular_plan;
+        if (adaptive)
+        {
+            angular_plan = angular_quadrature::make_plan(this_channel, configs);
+            angular_quadrature::print_plan(angular_plan, configs);
+        }
+        for (size_t idx_mom_bra = 0; idx_mom_bra < n; idx_mom_bra = idx_mom_bra + 1)
+        {
+            for (size_t idx_mom_ket = 0; idx_mom_ket < n; idx_mom_ket = idx_mom_ket + 1)
+            {
+                if (screen != nullptr && screen->skipped(idx_mom_bra, idx_mom_ket))
+                {
+                    continue;
+                }
+                double p_final = configs.momentum_mesh_points[idx_mom_bra];
+                double p_initial = configs.momentum_mesh_points[idx_mom_ket];
+                if (adaptive)
+                {
+                    size_t k = angular_plan.rule(idx_mom_bra, idx_mom_ket);
+                    v[idx_mom_bra * n + idx_mom_ket] = interaction_all::potential_element(l_final, l_initial, s, j, tz, p_final, p_initial, configs, configs.angular_ladder_points[k],
+                                                                                          configs.angular_ladder_weights[k]);
+                }
+                else
+                {
+                    v[idx_mom_bra * n + idx_mom_ket] = interaction_all::potential_element(l_final, l_initial, s, j, tz, p_final, p_initial, configs);
+                }
+            }
+        }
+        return v;
+    }
+
+    // result_name of the derivatives of the kernels with respect to "id", e.g. "n2lo-emn500-dlambda".
+    std::string derivative_name(const std::string &result_name, dual_numbers::parameter id)
+    {
+        return result_name + "-d" + dual_numbers::parameter_names[id];
+    }
+
+    // compute the matrix of one channel with dual numbers, in one evaluation per element: returns the values, which are
+    // those of compute_channel, and the derivatives with respect to configs.derivatives in "derivatives", row-major.
+    std::vector<double> compute_channel_derivatives(const std::vector<int> &this_channel, const NN::NN_configs &configs, std::vector<std::vector<double>> &derivatives,
+                                                    const screening::plan *screen = nullptr)
+    {
+        using dual_numbers::dual;
+        size_t n = configs.mesh_points_number;
+        std::vector<double> v(n * n, 0.0);
+        derivatives.assign(configs.derivatives.size(), std::vector<double>(n * n, 0.0));
+        if (screen != nullptr && screen->skip_channel)
+        {
+            return v;
+        }
+        bool adaptive = (configs.angular_mode == "adaptive");
+        angular_quadrature::plan angular_plan;
+        if (adaptive)
+        {
+            angular_plan = angular_quadrature::make_plan(this_channel, configs);
+            angular_quadrature::print_plan(angular_plan, configs);
+        }
+        for (size_t idx_mom_bra = 0; idx_mom_bra < n; idx_mom_bra = idx_mom_bra + 1)
+        {
+            for (size_t idx_mom_ket = 0; idx_mom_ket < n; idx_mom_ket = idx_mom_ket + 1)
+            {
+                if (screen != nullptr && screen->skipped(idx_mom_bra, idx_mom_ket))
+                {
+                    continue;
+                }
+                dual p_final = configs.momentum_mesh_points[idx_mom_bra];
+                dual p_initial = configs.momentum_mesh_points[idx_mom_ket];
+                size_t k = adaptive ? angular_plan.rule(idx_mom_bra, idx_mom_ket) : 0;
+                const auto &points = adaptive ? configs.angular_ladder_points[k] : configs.angular_mesh_points;
+                const auto &weights = adaptive ? configs.angular_ladder_weights[k] : configs.angular_mesh_weights;
+                dual element = interaction_all::potential_chiral<dual>(this_channel[0], this_channel[1], this_channel[2], this_channel[3], this_channel[4], p_final, p_initial,
+                                                                             configs, points, weights);
+                size_t idx = idx_mom_bra * n + idx_mom_ket;
+                v[idx] = element.v;
+                for (size_t idx_parameter = 0; idx_parameter < configs.derivatives.size(); idx_parameter = idx_parameter + 1)
+                {
+                    derivatives[idx_parameter][idx] = element.d[configs.derivatives[idx_parameter]];
+                }
+            }
+        }
+        return v;
+    }
+
+    // compute and write one channel, returns its matrix.
+    std::vector<double> write_dat_single_channel(std::vector<int> this_channel, const NN::NN_configs &configs)
+    {
+        auto v = compute_channel(this_channel, configs);
+        write_kernel_files(this_channel, configs, v);
+        return v;
+    }
+
+    // writes the kernels of "configs" in the layout of the [output] section: coupled_layout "separate" or
+    // "block" (the 2n x 2n matrix [[--, -+], [+-, ++]] of a coupled (j, tz) in one file), matrix_order "row"
+    // or "column", and weight_folding. the row-major matrices of the channels are passed in the order of
+    // partial_waves, the channels of a coupled block are held until the last one arrives. with compression = lowrank,
+    // the row-major matrix of every file is written as low-rank factors instead.
+    class kernel_writer
+    {
+    public:
+        kernel_writer(const NN::NN_configs &configs) : configs(configs) {}
+
+        void add(size_t idx_channel, const std::vector<double> &v)
+        {
+            const auto &this_channel = configs.partial_waves[idx_channel];
+            if (default_layout(configs))
+            {
+                write_kernel_files(this_channel, configs, v);
+                return;
+            }
+
+            size_t n = configs.mesh_points_number;
+            std::vector<double> folded = v;
+            if (configs.weight_folding)
+            {
+                for (size_t idx_element = 0; idx_element < n * n; idx_element = idx_element + 1)
+                {
+                    folded[idx_element] *= fold_factor(configs, idx_element / n, idx_element % n);
+                }
+            }
+            if (configs.coupled_layout == "block" && (!pending.empty() || coupled_group(configs.partial_waves, idx_channel)))
+            {
+                if (pending.empty())
+                {
+                    first_pending = idx_channel;
+                }
+                pending.push_back(std::move(folded));
+                if (pending.size() < 4)
+                {
+                    return;
+                }
+                std::vector<double> block(4 * n * n);
+                for (size_t b = 0; b < 4; b = b + 1)
+                {
+                    for (size_t idx_element = 0; idx_element < n * n; idx_element = idx_element + 1)
+                    {
+                        size_t row = (b / 2) * n + idx_element / n;
+                        size_t column = (b % 2) * n + idx_element % n;
+                        block[row * 2 * n + column] = pending[b][idx_element];
+                    }
+                }
+                pending.clear();
+                write(coupled_tag(configs.partial_waves[first_pending]), block, 2 * n);
+                return;
+            }
+            write(channel_tag(this_channel), folded, n);
+        }
+
+        // ranks and memory of the low-rank files written so far.
+        void print_compression() const
+        {
+            if (configs.compression != "lowrank" || files == 0)
+            {
+                return;
+            }
+            std::cout << "low-rank kernels: " << files << " files, rank " << rank_min << " to " << rank_max << ", " << stored_values << " of " << full_values
+                      << " values (" << std::setprecision(3) << double(full_values) / std::max<size_t>(stored_values, 1) << "x smaller)" << std::endl;
+        }
+
+    private:
+        const NN::NN_configs &configs;
+        std::vector<std::vector<double>> pending;
+        size_t first_pending = 0;
+        size_t files = 0, rank_min = 0, rank_max = 0, stored_values = 0, full_values = 0;
+
+        // write the row-major matrix "v" of "dim" x "dim" values to the files of "tag".
+        void write(const std::string &tag, const std::vector<double> &v, size_t dim)
+        {
+            if (configs.compression != "lowrank")
+            {
+                write_matrix_files(tag, configs, in_order(v, dim), dim);
+                return;
+            }
+            auto f = write_lowrank_file(tag, configs, v, dim);
+            rank_min = files == 0 ? f.rank : std::min(rank_min, f.rank);
+            rank_max = std::max(rank_max, f.rank);
+            stored_values += f.stored_values();
+            full_values += dim * dim;
+            files = files + 1;
+        }
+
+        // the row-major matrix "v" in the matrix_order of the files.
+        std::vector<double> in_order(const std::vector<double> &v, size_t dim) const
+        {
+            if (configs.matrix_order == "row")
+            {
+                return v;
+            }
+            std::vector<double> transposed(dim * dim);
+            for (size_t row = 0; row < dim; row = row + 1)
+            {
+                for (size_t column = 0; column < dim; column = column + 1)
+                {
+                    transposed[column * dim + row] = v[row * dim + column];
+                }
+            }
+            return transposed;
+        }
+    };
+
+    // width of one value in the text files of the tiled output, "%26.17e" leaves at least one blank before every value.
+    constexpr size_t tiled_txt_width = 26;
+
+    // write all "bytes" of "data" at "offset" of the file "fd".
+    bool pwrite_all(int fd, const char *data, size_t bytes, off_t offset)
+    {
+        while (bytes > 0)
+        {
+            ssize_t written = pwrite(fd, data, bytes, offset);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            bytes -= written;
+            offset += written;
+        }
+        return true;
+    }
+
+    // create the file "fname" with "bytes" preallocated.
+    int open_preallocated(const std::string &fname, size_t bytes)
+    {
+        int fd = open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            std::cerr << "failed to open file: " << fname << "!\n";
+            exit(-1);
+        }
+        if (posix_fallocate(fd, 0, bytes) != 0 && ftruncate(fd, bytes) != 0)
+        {
+            std::cerr << "failed to allocate " << bytes << " bytes for file: " << fname << "!\n";
+            exit(-1);
+        }
+        return fd;
+    }
+
+    // preallocated txt and bin files of a "dim" x "dim" matrix of the tiled output.
+    struct tiled_file
+    {
+        std::string txt;
+        std::string bin;
+        int fd_txt;
+        int fd_bin;
+        size_t dim;
+    };
+
+    tiled_file open_tiled_file(const std::string &tag, const NN::NN_configs &configs, size_t dim)
+    {
+        tiled_file file;
+        std::string file_base = configs.result_dir + "kernel-" + configs.result_name + "-" + tag;
+        size_t value_bytes = (configs.binary_precision == "float") ? sizeof(float) : sizeof(double);
+        file.txt = file_base + ".txt";
+        file.bin = file_base + (configs.binary_precision == "float" ? ".f32.bin" : ".bin");
+        file.dim = dim;
+        std::cout << "writing: " << file.txt << std::endl;
+        file.fd_txt = open_preallocated(file.txt, dim * (dim * tiled_txt_width + 1));
+        file.fd_bin = open_preallocated(file.bin, dim * dim * value_bytes);
+        return file;
+    }
+
+    void close_tiled_file(const tiled_file &file)
+    {
+        close(file.fd_txt);
+        close(file.fd_bin);
+        std::cout << "writing: " << file.bin << std::endl;
+    }
+
+    // compute one channel for large meshes and write it into the block ("block_row", "block_col") of "file".
+    // the lines of the matrix (rows, or columns with matrix_order = column) are cut into tiles, the threads
+    // compute one tile each, with the angular integration inside serial, and write it in place into the
+    // preallocated files. the txt values have the fixed width "tiled_txt_width", so every line has a known
+    // offset. the tiles held at a time fit in "memory_budget_mb", and there are at least four tiles per thread.
+    void write_dat_single_channel_tiled(const std::vector<int> &this_channel, const NN::NN_configs &configs, const tiled_file &file, size_t block_row, size_t block_col,
+                                        const screening::plan *screen = nullptr)
+    {
+        bool adaptive = (configs.angular_mode == "adaptive") && !(screen != nullptr && screen->skip_channel);
+        angular_quadrature::plan angular_plan;
+        if (adaptive)
+        {
+            angular_plan = angular_quadrature::make_plan(this_channel, configs);
+            angular_quadrature::print_plan(angular_plan, configs);
+        }
+
+        size_t n = configs.mesh_points_number;
+        bool single = (configs.binary_precision == "float");
+        bool by_row = (configs.matrix_order == "row");
+        size_t value_bytes = single ? sizeof(float) : sizeof(double);
+        size_t line_txt_bytes = file.dim * tiled_txt_width + 1;
+        size_t major_block = by_row ? block_row : block_col;
+        size_t minor_block = by_row ? block_col : block_row;
+        bool last_minor = ((minor_block + 1) * n == file.dim);
+        size_t segment_txt_bytes = n * tiled_txt_width + (last_minor ? 1 : 0);
+
+        size_t line_bytes = n * sizeof(double) + segment_txt_bytes + n * value_bytes;
+        size_t threads = omp_get_max_threads();
+        size_t budget_lines = static_cast<size_t>(configs.memory_budget_mb * 1e6) / (threads * line_bytes);
+        size_t tile_lines = std::max<size_t>(1, std::min(budget_lines, (n + 4 * threads - 1) / (4 * threads)));
+        size_t tiles = (n + tile_lines - 1) / tile_lines;
+        std::cout << "    " << channel_tag(this_channel) << ": " << tiles << " tiles of " << tile_lines << (by_row ? " rows" : " columns") << std::endl;
+
+        // the threads work on tiles, so the angular integration must not open nested teams.
+        int levels = omp_get_max_active_levels();
+        omp_set_max_active_levels(1);
+        bool good = true;
+#pragma omp parallel for schedule(dynamic)
+        for (size_t idx_tile = 0; idx_tile < tiles; idx_tile = idx_tile + 1)
+        {
+            size_t line_begin = idx_tile * tile_lines;
+            size_t lines = std::min(tile_lines, n - line_begin);
+            std::vector<double> v(lines * n);
+            for (size_t idx_line = 0; idx_line < lines; idx_line = idx_line + 1)
+            {
+                for (size_t idx_minor = 0; idx_minor < n; idx_minor = idx_minor + 1)
+                {
+                    size_t idx_mom_bra = by_row ? line_begin + idx_line : idx_minor;
+                    size_t idx_mom_ket = by_row ? idx_minor : line_begin + idx_line;
+                    double p_final = configs.momentum_mesh_points[idx_mom_bra];
+                    double p_initial = configs.momentum_mesh_points[idx_mom_ket];
+                    double value = 0.0;
+                    bool screened = (screen != nullptr && screen->skipped(idx_mom_bra, idx_mom_ket));
+                    if (screened)
+                    {
+                        // exact zero, below the screening bound.
+                    }
+                    else if (adaptive)
+                    {
+                        size_t k = angular_plan.rule(idx_mom_bra, idx_mom_ket);
+                        value = interaction_all::potential_element(this_channel[0], this_channel[1], this_channel[2], this_channel[3], this_channel[4], p_final, p_initial, configs,
+                                                                   configs.angular_ladder_points[k], configs.angular_ladder_weights[k]);
+                    }
+                    else
+                    {
+                        value = interaction_all::potential_element(this_channel[0], this_channel[1], this_channel[2], this_channel[3], this_channel[4], p_final, p_initial, configs);
+                    }
+                    if (configs.weight_folding)
+                    {
+                        value *= fold_factor(configs, idx_mom_bra, idx_mom_ket);
+                    }
+                    v[idx_line * n + idx_minor] = value;
+                }
+            }
+
+            std::string txt(lines * segment_txt_bytes, ' ');
+            {
+                profiler::scoped_timer timer(profiler::text_formatting);
+                char buffer[32];
+                for (size_t idx_line = 0; idx_line < lines; idx_line = idx_line + 1)
+                {
+                    for (size_t idx_minor = 0; idx_minor < n; idx_minor = idx_minor + 1)
+                    {
+                        std::snprintf(buffer, sizeof(buffer), "%26.17e", v[idx_line * n + idx_minor]);
+                        std::memcpy(&txt[idx_line * segment_txt_bytes + idx_minor * tiled_txt_width], buffer, tiled_txt_width);
+                    }
+                    if (last_minor)
+                    {
+                        txt[(idx_line + 1) * segment_txt_bytes - 1] = '\n';
+                    }
+                }
+            }
+            std::vector<char> bin(lines * n * value_bytes);
+            {
+                profiler::scoped_timer timer(profiler::binary_packing);
+                if (single)
+                {
+                    std::vector<float> v_single(v.begin(), v.end());
+                    std::memcpy(bin.data(), v_single.data(), bin.size());
+                }
+                else
+                {
+                    std::memcpy(bin.data(), v.data(), bin.size());
+                }
+            }
+            bool written = true;
+            for (size_t idx_line = 0; idx_line < lines && written; idx_line = idx_line + 1)
+            {
+                size_t line = major_block * n + line_begin + idx_line;
+                written = pwrite_all(file.fd_txt, txt.data() + idx_line * segment_txt_bytes, segment_txt_bytes, line * line_txt_bytes + minor_block * n * tiled_txt_width) &&
+                          pwrite_all(file.fd_bin, bin.data() + idx_line * n * value_bytes, n * value_bytes, (line * file.dim + minor_block * n) * value_bytes);
+            }
+            if (!written)
+            {
+#pragma omp atomic write
+                good = false;
+            }
+        }
+        omp_set_max_active_levels(levels);
+        if (!good)
+        {
+            std::cerr << "failed to write: " << file.txt << " or " << file.bin << "!\n";
+            exit(-1);
+        }
+    }
+
+    // the interaction of a run as the [interaction] section of the layout file: the settings that fix V(p', p) apart from
+    // the meshes, in the units of NN_configs and at full precision, so that a reader can check that its own settings give
+    // the same kernels.
+    std::vector<std::pair<std::string, std::string>> interaction_record(const NN::NN_configs &configs)
+    {
+        std::vector<std::pair<std::string, std::string>> record;
+        auto add = [&record](const std::string &key, const auto &value)
+        {
+            std::ostringstream oss;
+            oss << std::setprecision(17) << value;
+            record.push_back({key, oss.str()});
+        };
+        add("chiral_order", configs.chiral_order);
+        add("axial_current_coupling_constant", configs.axial_current_coupling_constant);
+        add("pion_decay_constant", configs.pion_decay_constant);
+        add("c1", configs.c1);
+        add("c2", configs.c2);
+        add("c3", configs.c3);
+        add("c4", configs.c4);
+        add("d1_plus_d2", configs.d1_plus_d2);
+        add("d3", configs.d3);
+        add("d5", configs.d5);
+        add("d14_minus_d15", configs.d14_minus_d15);
+        add("Ctilde_1s0_pp", configs.Ctilde_1s0_pp);
+        add("Ctilde_1s0_nn", configs.Ctilde_1s0_nn);
+        add("Ctilde_1s0_np", configs.Ctilde_1s0_np);
+        add("Ctilde_3s1", configs.Ctilde_3s1);
+        add("C_1s0", configs.C_1s0);
+        add("C_3s1", configs.C_3s1);
+        add("C_1p1", configs.C_1p1);
+        add("C_3p0", configs.C_3p0);
+        add("C_3p1", configs.C_3p1);
+        add("C_3sd1", configs.C_3sd1);
+        add("C_3p2", configs.C_3p2);
+        add("Lambda", configs.Lambda);
+        add("Lambda_tilde", configs.Lambda_tilde);
+        add("n_reg_Ctilde_1s0", configs.n_reg_Ctilde_1s0);
+        add("n_reg_Ctilde_3s1", configs.n_reg_Ctilde_3s1);
+        add("n_reg_C_1s0", configs.n_reg_C_1s0);
+        add("n_reg_C_3s1", configs.n_reg_C_3s1);
+        add("n_reg_C_1p1", configs.n_reg_C_1p1);
+        add("n_reg_C_3p0", configs.n_reg_C_3p0);
+        add("n_reg_C_3p1", configs.n_reg_C_3p1);
+        add("n_reg_C_3sd1", configs.n_reg_C_3sd1);
+        add("n_reg_C_3p2", configs.n_reg_C_3p2);
+        add("n_reg_one_pion_exchange", configs.n_reg_one_pion_exchange);
+        add("n_reg_two_pion_exchange_nlo", configs.n_reg_two_pion_exchange_nlo);
+        add("n_reg_two_pion_exchange_n2lo", configs.n_reg_two_pion_exchange_n2lo);
+        add("n_reg_two_pion_exchange_n3lo", configs.n_reg_two_pion_exchange_n3lo);
+        add("mass_pion_charged", configs.mass_pion_charged);
+        add("mass_pion_neutral", configs.mass_pion_neutral);
+        add("mass_pion_averaged", configs.mass_pion_averaged);
+        add("mass_proton", configs.mass_proton);
+        add("mass_neutron", configs.mass_neutron);
+        add("mass_nucleon", configs.mass_nucleon);
+        add("ope_projection", configs.ope_projection);
+        add("tpe_projection", configs.tpe_projection);
+        add("tpe_spectral_points", configs.tpe_spectral_points);
+        add("derivation", configs.derivation.empty() ? "none" : configs.derivation);
+        return record;
+    }
+
+    // write the layout of the kernel files, readable with inifile_system::inifile.
+    void write_layout(const NN::NN_configs &configs)
+    {
+        size_t n = configs.mesh_points_number;
+        const auto &channels = configs.partial_waves;
+        std::ofstream fp(configs.result_dir + configs.result_name + "-kernel-layout.txt");
+        if (configs.compression == "lowrank")
+        {
+            fp << "# layout of the low-rank kernel files kernel-" << configs.result_name << "-<tag>.lowrank.bin, see kernel_lowrank.hpp;\n";
+        }
+        else
+        {
+            fp << "# layout of the kernel files kernel-" << configs.result_name << "-<tag>.txt and .bin;\n";
+        }
+        fp << "[layout]\n";
+        fp << "coupled_layout = " << configs.coupled_layout << "\n";
+        fp << "matrix_order = " << configs.matrix_order << "\n";
+        fp << "# with weight_folding the files hold V(p', p) * p' * p * sqrt(w' * w) of the momentum mesh;\n";
+        fp << "weight_folding = " << (configs.weight_folding ? "true" : "false") << "\n";
+        fp << "binary_precision = " << configs.binary_precision << "\n";
+        fp << "compression = " << configs.compression << "\n";
+        if (configs.compression == "lowrank")
+        {
+            fp << "compression_tolerance = " << configs.compression_tolerance << "\n";
+        }
+        fp << "txt_format = " << (configs.tiled_output ? "fixed-width" : "free") << "\n";
+        fp << "mesh_points = " << n << "\n";
+        fp << "[files]\n";
+        fp << "# tag = rows x columns: channels of the blocks, row by row;\n";
+        for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+        {
+            if (configs.coupled_layout == "block" && coupled_group(channels, idx))
+            {
+                fp << coupled_tag(channels[idx]) << " = " << 2 * n << " x " << 2 * n << ":";
+                for (size_t b = 0; b < 4; b = b + 1)
+                {
+                    fp << " " << channel_tag(channels[idx + b]);
+                }
+                fp << "\n";
+                idx = idx + 3;
+                continue;
+            }
+            fp << channel_tag(channels[idx]) << " = " << n << " x " << n << ": " << channel_tag(channels[idx]) << "\n";
+        }
+        fp << "[interaction]\n";
+        fp << "# settings that fix the kernels apart from the meshes;\n";
+        for (const auto &[key, value] : interaction_record(configs))
+        {
+            fp << key << " = " << value << "\n";
+        }
+    }
+
+    // write the momentum mesh, the list of partial-waves and the layout of the kernel files.
+    void write_mesh_and_partial_waves(const NN::NN_configs &configs)
+    {
+        // write momentum mesh.
+        std::ostringstream oss_mom_mesh;
+        oss_mom_mesh << configs.result_dir << configs.result_name << "-momentum-mesh.txt";
+        auto file_mom_mesh = oss_mom_mesh.str();
+        std::ofstream fp_mom_mesh(file_mom_mesh);
+        fp_mom_mesh << "# momentum mesh points number;\n";
+        fp_mom_mesh << "# momentum mesh points and weights;\n";
+        fp_mom_mesh << configs.mesh_points_number << "\n";
+        for (size_t i = 0; i < configs.momentum_mesh_points.size(); i = i + 1)
+        {
+            fp_mom_mesh << std::fixed << std::scientific << std::setprecision(17) << configs.momentum_mesh_points[i] << "\t" << std::setw(17) << configs.momentum_mesh_weights[i] << std::endl;
+        }
+        fp_mom_mesh.close();
+
+        // write partial-waves.
+        std::ostringstream oss_pws;
+        oss_pws << configs.result_dir << configs.result_name << "-partial-waves.txt";
+        auto file_pws = oss_pws.str();
+        std::ofstream fp_pws(file_pws);
+        fp_pws << "# partial-waves: l' l s j tz;\n";
+        for (size_t i = 0; i < configs.partial_waves.size(); i = i + 1)
+        {
+            fp_pws << configs.partial_waves[i][0] << " " << configs.partial_waves[i][1] << " " << configs.partial_waves[i][2] << " " << configs.partial_waves[i][3] << " " << configs.partial_waves[i][4] << "\n";
+        }
+        fp_pws.close();
+
+        write_layout(configs);
+    }
+
+    // write results in the output file.
+    void write_dat(const NN::NN_configs &configs)
+    {
+        write_mesh_and_partial_waves(configs);
+
+        // generate channels.
+        auto channels = configs.partial_waves;
+        size_t n = configs.mesh_points_number;
+
+        // blocks below the regulator bound, written as zeros.
+        std::vector<screening::plan> screens;
+        if (configs.screening)
+        {
+            screens = screening::make_plans(configs);
+            screening::print_summary(screens);
+        }
+        auto screen = [&screens](size_t idx_channel)
+        { return screens.empty() ? nullptr : &screens[idx_channel]; };
+
+        if (configs.tiled_output)
+        {
+            for (size_t idx_channel = 0; idx_channel < channels.size(); idx_channel = idx_channel + 1)
+            {
+                profiler::set_channel(idx_channel);
+                if (configs.coupled_layout == "block" && coupled_group(channels, idx_channel))
+                {
+                    auto file = open_tiled_file(coupled_tag(channels[idx_channel]), configs, 2 * n);
+                    for (size_t b = 0; b < 4; b = b + 1)
+                    {
+                        profiler::set_channel(idx_channel + b);
+                        write_dat_single_channel_tiled(channels[idx_channel + b], configs, file, b / 2, b % 2, screen(idx_channel + b));
+                    }
+                    close_tiled_file(file);
+                    idx_channel = idx_channel + 3;
+                    continue;
+                }
+                auto file = open_tiled_file(channel_tag(channels[idx_channel]), configs, n);
+                write_dat_single_channel_tiled(channels[idx_channel], configs, file, 0, 0, screen(idx_channel));
+                close_tiled_file(file);
+            }
+            return;
+        }
+
+        // the derivatives are written like the kernels, under their own result_name.
+        std::vector<NN::NN_configs> derivative_configs;
+        for (auto id : configs.derivatives)
+        {
+            derivative_configs.push_back(configs);
+            derivative_configs.back().result_name = derivative_name(configs.result_name, id);
+            derivative_configs.back().derivation = "derivative d" + dual_numbers::parameter_names[id];
+            write_mesh_and_partial_waves(derivative_configs.back());
+        }
+        std::vector<kernel_writer> derivative_writers(derivative_configs.begin(), derivative_configs.end());
+
+        kernel_writer writer(configs);
+        std::vector<std::vector<double>> kernels;
+        for (size_t idx_channel = 0; idx_channel < channels.size(); idx_channel = idx_channel + 1)
+        {
+            // write matrix elements for each channel.
+            auto this_channel = channels[idx_channel];
+            profiler::set_channel(idx_channel);
+            std::vector<double> v;
+            if (configs.derivatives.empty())
+            {
+                v = compute_channel(this_channel, configs, screen(idx_channel));
+            }
+            else
+            {
+                std::vector<std::vector<double>> derivatives;
+                v = compute_channel_derivatives(this_channel, configs, derivatives, screen(idx_channel));
+                for (size_t idx_parameter = 0; idx_parameter < derivatives.size(); idx_parameter = idx_parameter + 1)
+                {
+                    derivative_writers[idx_parameter].add(idx_channel, derivatives[idx_parameter]);
+                }
+            }
+            writer.add(idx_channel, v);
+            if (!configs.shm_name.empty())
+            {
+                kernels.push_back(std::move(v));
+            }
+        }
+        writer.print_compression();
+
+        // publish the kernel set in shared memory, always row-major per channel without weights.
+        if (!configs.shm_name.empty())
+        {
+            auto error = kernel_store::publish(configs.shm_name, configs.result_name, channels, configs.momentum_mesh_points, configs.momentum_mesh_weights, kernels);
+            if (!error.empty())
+            {
+                std::cerr << error << std::endl;
+                exit(-1);
+            }
+            std::cout << "published in shared memory: " << configs.shm_name << std::endl;
+        }
+    }
+
+} // namespace kernel_output
+
+#endif // KERNEL_OUTPUT_HPP
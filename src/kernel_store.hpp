@@ -0,0 +1,202 @@
+#pragma once
+#ifndef KERNEL_STORE_HPP
+#define KERNEL_STORE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// a kernel set in a named POSIX shared-memory segment, so that the solver processes of a node map one copy
+// read-only instead of reading the kernel files into private memory. this header does not depend on the rest
+// of the code and can be included by consumers.
+//
+// layout: header, one channel_entry per channel, mesh points and weights (n doubles each), then the n x n
+// kernels of the channels, row-major, in the order of the entries. "magic" is written last, a segment is
+// complete once it reads "NNCMSKS". publishing again unlinks the old segment and creates a new one with
+// a larger "generation", processes that are attached keep their mapping of the old one.
+namespace kernel_store
+{
+    constexpr char magic[8] = "NNCMSKS";
+    constexpr uint32_t format_version = 1;
+
+    struct header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t value_bytes; // 8, kernels are doubles.
+        uint64_t generation;
+        uint64_t total_bytes;
+        uint64_t mesh_points_number;
+        uint64_t channel_number;
+        char result_name[64];
+    };
+
+    struct channel_entry
+    {
+        int32_t channel[5]; // l', l, s, j, tz.
+        int32_t reserved;
+        uint64_t offset; // of the kernel in bytes from the start of the segment.
+    };
+
+    // read-only mapping of a published kernel set.
+    class view
+    {
+    public:
+        view(const std::string &name)
+        {
+            int fd = shm_open(name.c_str(), O_RDONLY, 0);
+            if (fd < 0)
+            {
+                msg = "cannot open shared-memory segment: " + name;
+                return;
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(header))
+            {
+                msg = "shared-memory segment too small: " + name;
+                close(fd);
+                return;
+            }
+            bytes = st.st_size;
+            void *p = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED)
+            {
+                msg = "cannot map shared-memory segment: " + name;
+                return;
+            }
+            base = static_cast<const char *>(p);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const auto &h = *reinterpret_cast<const header *>(base);
+            if (std::memcmp(h.magic, magic, sizeof(magic)) != 0)
+            {
+                msg = "not a complete kernel set: " + name;
+            }
+            else if (h.version != format_version || h.value_bytes != sizeof(double))
+            {
+                msg = "unsupported kernel set version: " + std::to_string(h.version);
+            }
+            else if (h.total_bytes != bytes)
+            {
+                msg = "kernel set size does not match its header: " + name;
+            }
+        }
+        view(const view &) = delete;
+        view &operator=(const view &) = delete;
+        ~view()
+        {
+            if (base != nullptr)
+            {
+                munmap(const_cast<char *>(base), bytes);
+            }
+        }
+
+        bool good() const { return base != nullptr && msg.empty(); }
+        std::string error() const { return msg; }
+
+        const header &info() const { return *reinterpret_cast<const header *>(base); }
+        size_t mesh_points_number() const { return info().mesh_points_number; }
+        size_t channel_number() const { return info().channel_number; }
+        const channel_entry &entry(size_t i) const { return reinterpret_cast<const channel_entry *>(base + sizeof(header))[i]; }
+        const double *mesh_points() const { return reinterpret_cast<const double *>(base + sizeof(header) + channel_number() * sizeof(channel_entry)); }
+        const double *mesh_weights() const { return mesh_points() + mesh_points_number(); }
+        const double *kernel(size_t i) const { return reinterpret_cast<const double *>(base + entry(i).offset); }
+
+        // kernel of channel [l', l, s, j, tz], nullptr if it is not in the set.
+        const double *kernel(const std::vector<int> &channel) const
+        {
+            for (size_t i = 0; i < channel_number(); i = i + 1)
+            {
+                if (std::equal(channel.begin(), channel.end(), entry(i).channel))
+                {
+                    return kernel(i);
+                }
+            }
+            return nullptr;
+        }
+
+    private:
+        const char *base = nullptr;
+        size_t bytes = 0;
+        std::string msg;
+    };
+
+    // publish a kernel set under "name" (e.g. "/nncms-n2lo-emn500"), returns an empty string or an error message.
+    std::string publish(const std::string &name, const std::string &result_name, const std::vector<std::vector<int>> &channels, const std::vector<double> &mesh_points,
+                        const std::vector<double> &mesh_weights, const std::vector<std::vector<double>> &kernels)
+    {
+        size_t n = mesh_points.size();
+        size_t offset = sizeof(header) + channels.size() * sizeof(channel_entry) + 2 * n * sizeof(double);
+        size_t total_bytes = offset + channels.size() * n * n * sizeof(double);
+
+        uint64_t generation = 1;
+        {
+            view old(name);
+            if (old.good())
+            {
+                generation = old.info().generation + 1;
+            }
+        }
+        shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0444);
+        if (fd < 0)
+        {
+            return "cannot create shared-memory segment: " + name;
+        }
+        if (ftruncate(fd, total_bytes) != 0)
+        {
+            close(fd);
+            shm_unlink(name.c_str());
+            return "cannot size shared-memory segment: " + name;
+        }
+        void *p = mmap(nullptr, total_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED)
+        {
+            shm_unlink(name.c_str());
+            return "cannot map shared-memory segment: " + name;
+        }
+        char *base = static_cast<char *>(p);
+
+        auto &h = *reinterpret_cast<header *>(base);
+        h.version = format_version;
+        h.value_bytes = sizeof(double);
+        h.generation = generation;
+        h.total_bytes = total_bytes;
+        h.mesh_points_number = n;
+        h.channel_number = channels.size();
+        std::strncpy(h.result_name, result_name.c_str(), sizeof(h.result_name) - 1);
+        auto *entries = reinterpret_cast<channel_entry *>(base + sizeof(header));
+        for (size_t i = 0; i < channels.size(); i = i + 1)
+        {
+            std::copy(channels[i].begin(), channels[i].end(), entries[i].channel);
+            entries[i].offset = offset + i * n * n * sizeof(double);
+            std::memcpy(base + entries[i].offset, kernels[i].data(), n * n * sizeof(double));
+        }
+        auto *mesh = reinterpret_cast<double *>(base + sizeof(header) + channels.size() * sizeof(channel_entry));
+        std::memcpy(mesh, mesh_points.data(), n * sizeof(double));
+        std::memcpy(mesh + n, mesh_weights.data(), n * sizeof(double));
+
+        // the segment becomes valid with its magic.
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(h.magic, magic, sizeof(magic));
+        munmap(p, total_bytes);
+        return "";
+    }
+
+    // remove a published kernel set, attached processes keep their mapping.
+    bool unlink(const std::string &name)
+    {
+        return shm_unlink(name.c_str()) == 0;
+    }
+
+} // namespace kernel_store
+
+#endif // KERNEL_STORE_HPP
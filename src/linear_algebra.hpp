@@ -0,0 +1,408 @@
+#pragma once
+#ifndef LINEAR_ALGEBRA_HPP
+#define LINEAR_ALGEBRA_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// dense linear algebra of the phase-shift, deuteron, srg and oscillator modes and of the low-rank output.
+// matrices are row-major std::vector<double>.
+namespace linear_algebra
+{
+    // panel width of the blocked factorization, a panel of 32 columns of a few hundred rows stays in L1/L2.
+    constexpr size_t lu_block = 32;
+
+    // lu factorization with partial pivoting, in place: a = P L U with unit lower L.
+    // "pivot[k]" is the row swapped with row k at step k. returns false for a singular matrix.
+    // right-looking and blocked: a panel of "lu_block" columns is factorized unblocked, then the
+    // trailing matrix is updated with one matrix product, so the update runs over contiguous rows.
+    bool lu_factorize(std::vector<double> &a, size_t n, std::vector<size_t> &pivot)
+    {
+        pivot.resize(n);
+        for (size_t k0 = 0; k0 < n; k0 = k0 + lu_block)
+        {
+            size_t k1 = std::min(n, k0 + lu_block);
+
+            // unblocked factorization of the panel a[k0:n, k0:k1], the row swaps are applied to whole rows.
+            for (size_t k = k0; k < k1; k = k + 1)
+            {
+                size_t p = k;
+                for (size_t i = k + 1; i < n; i = i + 1)
+                {
+                    if (std::abs(a[i * n + k]) > std::abs(a[p * n + k]))
+                    {
+                        p = i;
+                    }
+                }
+                pivot[k] = p;
+                if (a[p * n + k] == 0.0)
+                {
+                    return false;
+                }
+                if (p != k)
+                {
+                    std::swap_ranges(a.begin() + k * n, a.begin() + (k + 1) * n, a.begin() + p * n);
+                }
+                double inv = 1.0 / a[k * n + k];
+                for (size_t i = k + 1; i < n; i = i + 1)
+                {
+                    double l = a[i * n + k] * inv;
+                    a[i * n + k] = l;
+                    for (size_t c = k + 1; c < k1; c = c + 1)
+                    {
+                        a[i * n + c] -= l * a[k * n + c];
+                    }
+                }
+            }
+
+            // block row of U: a[k0:k1, k1:n] = L11^-1 a[k0:k1, k1:n].
+            for (size_t k = k0; k < k1; k = k + 1)
+            {
+                for (size_t i = k + 1; i < k1; i = i + 1)
+                {
+                    double l = a[i * n + k];
+                    for (size_t c = k1; c < n; c = c + 1)
+                    {
+                        a[i * n + c] -= l * a[k * n + c];
+                    }
+                }
+            }
+
+            // trailing update: a[k1:n, k1:n] -= L21 U12.
+            for (size_t i = k1; i < n; i = i + 1)
+            {
+                double *row = a.data() + i * n;
+                for (size_t k = k0; k < k1; k = k + 1)
+                {
+                    double l = row[k];
+                    const double *u = a.data() + k * n;
+                    for (size_t c = k1; c < n; c = c + 1)
+                    {
+                        row[c] -= l * u[c];
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // solve a x = b in place of "b" with the factorization of lu_factorize.
+    void lu_solve(const std::vector<double> &lu, size_t n, const std::vector<size_t> &pivot, std::vector<double> &b)
+    {
+        for (size_t k = 0; k < n; k = k + 1)
+        {
+            std::swap(b[k], b[pivot[k]]);
+        }
+        for (size_t i = 1; i < n; i = i + 1)
+        {
+            double sum = b[i];
+            for (size_t k = 0; k < i; k = k + 1)
+            {
+                sum -= lu[i * n + k] * b[k];
+            }
+            b[i] = sum;
+        }
+        for (size_t i = n; i-- > 0;)
+        {
+            double sum = b[i];
+            for (size_t k = i + 1; k < n; k = k + 1)
+            {
+                sum -= lu[i * n + k] * b[k];
+            }
+            b[i] = sum / lu[i * n + i];
+        }
+    }
+
+    // c = a b of a "rows" x "inner" and an "inner" x "columns" matrix. blocked over rows, the inner dimension and
+    // columns, so that a block of b is reused from cache for a block of rows, with the innermost loop over contiguous
+    // columns. the row blocks are distributed over the threads, and run serially inside an enclosing parallel region.
+    void multiply(const std::vector<double> &a, const std::vector<double> &b, std::vector<double> &c, size_t rows, size_t inner, size_t columns)
+    {
+        const size_t row_block = 16, block = 64;
+        c.assign(rows * columns, 0.0);
+#pragma omp parallel for schedule(static)
+        for (size_t i0 = 0; i0 < rows; i0 = i0 + row_block)
+        {
+            size_t i1 = std::min(rows, i0 + row_block);
+            for (size_t k0 = 0; k0 < inner; k0 = k0 + block)
+            {
+                size_t k1 = std::min(inner, k0 + block);
+                for (size_t j0 = 0; j0 < columns; j0 = j0 + block)
+                {
+                    size_t j1 = std::min(columns, j0 + block);
+                    for (size_t i = i0; i < i1; i = i + 1)
+                    {
+                        double *c_row = c.data() + i * columns;
+                        for (size_t k = k0; k < k1; k = k + 1)
+                        {
+                            double a_ik = a[i * inner + k];
+                            const double *b_row = b.data() + k * columns;
+                            for (size_t j = j0; j < j1; j = j + 1)
+                            {
+                                c_row[j] += a_ik * b_row[j];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // c = a b of n x n matrices.
+    void multiply(const std::vector<double> &a, const std::vector<double> &b, std::vector<double> &c, size_t n)
+    {
+        multiply(a, b, c, n, n, n);
+    }
+
+    // truncated householder qr with column pivoting of the "rows" x "columns" matrix "a": a ~ q r with q of
+    // orthonormal columns ("rows" x k) and r ("k" x "columns", in the original column order). the column of the
+    // largest remaining norm is eliminated next, and the factorization stops when that norm is at most "tolerance",
+    // so the columns left out are all below it. returns the rank k.
+    size_t pivoted_qr(std::vector<double> a, size_t rows, size_t columns, double tolerance, std::vector<double> &q, std::vector<double> &r)
+    {
+        size_t k_max = std::min(rows, columns);
+        std::vector<size_t> permutation(columns);
+        for (size_t j = 0; j < columns; j = j + 1)
+        {
+            permutation[j] = j;
+        }
+        std::vector<std::vector<double>> reflectors;
+        std::vector<double> norms(columns), betas;
+        size_t k = 0;
+        for (; k < k_max; k = k + 1)
+        {
+            // remaining column norms, recomputed rather than downdated to avoid cancellation.
+            std::fill(norms.begin() + k, norms.end(), 0.0);
+            for (size_t i = k; i < rows; i = i + 1)
+            {
+                const double *a_row = a.data() + i * columns;
+                for (size_t j = k; j < columns; j = j + 1)
+                {
+                    norms[j] += a_row[j] * a_row[j];
+                }
+            }
+            size_t pivot = std::max_element(norms.begin() + k, norms.end()) - norms.begin();
+            if (std::sqrt(norms[pivot]) <= tolerance)
+            {
+                break;
+            }
+            if (pivot != k)
+            {
+                for (size_t i = 0; i < rows; i = i + 1)
+                {
+                    std::swap(a[i * columns + k], a[i * columns + pivot]);
+                }
+                std::swap(permutation[k], permutation[pivot]);
+            }
+
+            // reflector I - beta v v^T with v_0 = 1 that maps a[k:, k] onto alpha e_0.
+            double alpha = std::sqrt(norms[pivot]);
+            double x0 = a[k * columns + k];
+            alpha = x0 > 0.0 ? -alpha : alpha;
+            std::vector<double> v(rows - k);
+            v[0] = 1.0;
+            for (size_t i = k + 1; i < rows; i = i + 1)
+            {
+                v[i - k] = a[i * columns + k] / (x0 - alpha);
+            }
+            double beta = (alpha - x0) / alpha;
+            std::vector<double> projection(columns - k, 0.0);
+            for (size_t i = k; i < rows; i = i + 1)
+            {
+                const double *a_row = a.data() + i * columns;
+                for (size_t j = k; j < columns; j = j + 1)
+                {
+                    projection[j - k] += v[i - k] * a_row[j];
+                }
+            }
+            for (size_t i = k; i < rows; i = i + 1)
+            {
+                double *a_row = a.data() + i * columns;
+                double factor = beta * v[i - k];
+                for (size_t j = k; j < columns; j = j + 1)
+                {
+                    a_row[j] -= factor * projection[j - k];
+                }
+            }
+            reflectors.push_back(std::move(v));
+            betas.push_back(beta);
+        }
+
+        // q = H_0 .. H_k-1 applied to the first k columns of the identity, backwards.
+        q.assign(rows * k, 0.0);
+        for (size_t i = 0; i < k; i = i + 1)
+        {
+            q[i * k + i] = 1.0;
+        }
+        for (size_t h = k; h-- > 0;)
+        {
+            const auto &v = reflectors[h];
+            std::vector<double> projection(k, 0.0);
+            for (size_t i = h; i < rows; i = i + 1)
+            {
+                for (size_t j = 0; j < k; j = j + 1)
+                {
+                    projection[j] += v[i - h] * q[i * k + j];
+                }
+            }
+            for (size_t i = h; i < rows; i = i + 1)
+            {
+                double factor = betas[h] * v[i - h];
+                for (size_t j = 0; j < k; j = j + 1)
+                {
+                    q[i * k + j] -= factor * projection[j];
+                }
+            }
+        }
+
+        // upper trapezoidal r, with the pivoting undone.
+        r.assign(k * columns, 0.0);
+        for (size_t i = 0; i < k; i = i + 1)
+        {
+            for (size_t j = i; j < columns; j = j + 1)
+            {
+                r[i * columns + permutation[j]] = a[i * columns + j];
+            }
+        }
+        return k;
+    }
+
+    // one-sided jacobi svd of the "k" x "columns" matrix "b" with k <= columns: plane rotations of pairs of rows are
+    // applied until all rows are orthogonal, then b = g^T diag(s) u with u of orthonormal rows. on return "b" holds u,
+    // "s" the singular values and "g" the k x k orthogonal product of the rotations, all unsorted.
+    void jacobi_svd(std::vector<double> &b, size_t k, size_t columns, std::vector<double> &s, std::vector<double> &g)
+    {
+        g.assign(k * k, 0.0);
+        for (size_t i = 0; i < k; i = i + 1)
+        {
+            g[i * k + i] = 1.0;
+        }
+        for (int sweep = 0; sweep < 60; sweep = sweep + 1)
+        {
+            bool rotated = false;
+            for (size_t i = 0; i + 1 < k; i = i + 1)
+            {
+                for (size_t j = i + 1; j < k; j = j + 1)
+                {
+                    double *b_i = b.data() + i * columns;
+                    double *b_j = b.data() + j * columns;
+                    double alpha = 0.0, beta = 0.0, gamma = 0.0;
+                    for (size_t c = 0; c < columns; c = c + 1)
+                    {
+                        alpha += b_i[c] * b_i[c];
+                        beta += b_j[c] * b_j[c];
+                        gamma += b_i[c] * b_j[c];
+                    }
+                    if (std::fabs(gamma) <= 1e-15 * std::sqrt(alpha * beta) || gamma == 0.0)
+                    {
+                        continue;
+                    }
+                    rotated = true;
+                    double zeta = (beta - alpha) / (2.0 * gamma);
+                    double t = (zeta >= 0.0 ? 1.0 : -1.0) / (std::fabs(zeta) + std::sqrt(1.0 + zeta * zeta));
+                    double cosine = 1.0 / std::sqrt(1.0 + t * t), sine = cosine * t;
+                    for (size_t c = 0; c < columns; c = c + 1)
+                    {
+                        double x = b_i[c], y = b_j[c];
+                        b_i[c] = cosine * x - sine * y;
+                        b_j[c] = sine * x + cosine * y;
+                    }
+                    for (size_t c = 0; c < k; c = c + 1)
+                    {
+                        double x = g[i * k + c], y = g[j * k + c];
+                        g[i * k + c] = cosine * x - sine * y;
+                        g[j * k + c] = sine * x + cosine * y;
+                    }
+                }
+            }
+            if (!rotated)
+            {
+                break;
+            }
+        }
+        s.assign(k, 0.0);
+        for (size_t i = 0; i < k; i = i + 1)
+        {
+            double *b_i = b.data() + i * columns;
+            for (size_t c = 0; c < columns; c = c + 1)
+            {
+                s[i] += b_i[c] * b_i[c];
+            }
+            s[i] = std::sqrt(s[i]);
+            for (size_t c = 0; c < columns && s[i] > 0.0; c = c + 1)
+            {
+                b_i[c] /= s[i];
+            }
+        }
+    }
+
+    // cyclic jacobi eigenvalue method of the symmetric n x n matrix "a": a = z diag(values) z^T, with the
+    // eigenvectors in the columns of "z", unsorted. "a" is overwritten.
+    void jacobi_eigen(std::vector<double> &a, size_t n, std::vector<double> &values, std::vector<double> &z)
+    {
+        z.assign(n * n, 0.0);
+        for (size_t i = 0; i < n; i = i + 1)
+        {
+            z[i * n + i] = 1.0;
+        }
+        for (int sweep = 0; sweep < 60; sweep = sweep + 1)
+        {
+            double off = 0.0, diagonal = 0.0;
+            for (size_t i = 0; i < n; i = i + 1)
+            {
+                diagonal += a[i * n + i] * a[i * n + i];
+                for (size_t j = i + 1; j < n; j = j + 1)
+                {
+                    off += a[i * n + j] * a[i * n + j];
+                }
+            }
+            if (off <= 1e-32 * diagonal)
+            {
+                break;
+            }
+            for (size_t p = 0; p + 1 < n; p = p + 1)
+            {
+                for (size_t q = p + 1; q < n; q = q + 1)
+                {
+                    double a_pq = a[p * n + q];
+                    if (a_pq == 0.0)
+                    {
+                        continue;
+                    }
+                    double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * a_pq);
+                    double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(1.0 + theta * theta));
+                    double cosine = 1.0 / std::sqrt(1.0 + t * t), sine = cosine * t;
+                    // a <- J^T a J with the rotation J in the (p, q) plane, rows then columns.
+                    for (size_t c = 0; c < n; c = c + 1)
+                    {
+                        double x = a[p * n + c], y = a[q * n + c];
+                        a[p * n + c] = cosine * x - sine * y;
+                        a[q * n + c] = sine * x + cosine * y;
+                    }
+                    for (size_t c = 0; c < n; c = c + 1)
+                    {
+                        double x = a[c * n + p], y = a[c * n + q];
+                        a[c * n + p] = cosine * x - sine * y;
+                        a[c * n + q] = sine * x + cosine * y;
+                    }
+                    for (size_t c = 0; c < n; c = c + 1)
+                    {
+                        double x = z[c * n + p], y = z[c * n + q];
+                        z[c * n + p] = cosine * x - sine * y;
+                        z[c * n + q] = sine * x + cosine * y;
+                    }
+                }
+            }
+        }
+        values.resize(n);
+        for (size_t i = 0; i < n; i = i + 1)
+        {
+            values[i] = a[i * n + i];
+        }
+    }
+
+} // namespace linear_algebra
+
+#endif // LINEAR_ALGEBRA_HPP
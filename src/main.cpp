@@ -1,125 +1,39 @@
 #include "lib_define.hpp"
 #include "interaction_all.hpp"
+#include "bound_state.hpp"
+#include "equivalence.hpp"
+#include "ho_transform.hpp"
+#include "kernel_output.hpp"
+#include "manifest.hpp"
+#include "phase_shifts.hpp"
+#include "planner.hpp"
+#include "remesh.hpp"
+#include "service.hpp"
+#include "srg.hpp"
 
-// pack the readable file "txtfname" to binary file "binfname",
-// they have the same number of double values.
-void pack_kernel_file(const std::string &txtfname, const std::string &binfname, const size_t num)
+int main(int argc, char **argv)
+try
 {
-    std::ifstream fp_txt(txtfname);
-    if (!fp_txt.is_open())
+    //---- run mode from the command line, the default is writing all kernels.
+    std::string run_mode = (argc > 1) ? argv[1] : "";
+    if ((run_mode != "" && run_mode != "--check-equivalence" && run_mode != "--precision-report" && run_mode != "--manifest" && run_mode != "--serve" &&
+         run_mode != "--plan" && run_mode != "--phase-shifts" && run_mode != "--deuteron" &&
+         run_mode != "--srg" && run_mode != "--ho" && run_mode != "--remesh") ||
+        (run_mode == "--manifest" && argc < 3))
     {
-        std::cerr << "failed to open interaction file: " << txtfname << std::endl;
-    }
-    std::ofstream fp_bin(binfname, std::ios::binary);
-    for (size_t i = 0; i < num; i = i + 1)
-    {
-        double value;
-        fp_txt >> value;
-        fp_bin.write(reinterpret_cast<const char *>(&value), sizeof(double));
-    }
-    fp_txt.close();
-    fp_bin.close();
-}
-
-void write_dat_single_channel(std::vector<int> this_channel, const NN::NN_configs &configs)
-{
-    int l_final, l_initial, s, j, tz;
-    l_final = this_channel[0];
-    l_initial = this_channel[1];
-    s = this_channel[2];
-    j = this_channel[3];
-    tz = this_channel[4];
-    std::string tz_name;
-    if (tz == -1)
-    {
-        tz_name = "pp";
-    }
-    else if (tz == 0)
-    {
-        tz_name = "np";
-    }
-    else if (tz == 1)
-    {
-        tz_name = "nn";
-    }
-    else
-    {
-        tz_name = "???";
-    }
-
-    // write txt file for this partial-wave channel.
-    std::ostringstream oss_txt;
-    oss_txt << configs.result_dir << "kernel-" << configs.result_name << "-" << l_final << "-" << l_initial << "-" << s << "-" << j << "-" << tz_name << ".txt";
-    auto file_txt_name_this_channel = oss_txt.str();
-    std::cout << "writing: " << file_txt_name_this_channel << std::endl;
-    std::ofstream fp(file_txt_name_this_channel);
-    if (!fp.is_open())
-    {
-        std::cerr << "failed to open file: " << file_txt_name_this_channel << "!\n";
+        std::cerr << "unknown option: " << run_mode << "\n"
+                  << "usage: NN-cms.x [--check-equivalence | --precision-report | --plan | --phase-shifts | --deuteron | --srg | --ho | --remesh | --manifest file.ini | --serve [base.ini]]" << std::endl;
         exit(-1);
     }
-    for (size_t idx_mom_bra = 0; idx_mom_bra < configs.mesh_points_number; idx_mom_bra = idx_mom_bra + 1)
-    {
-        for (size_t idx_mom_ket = 0; idx_mom_ket < configs.mesh_points_number; idx_mom_ket = idx_mom_ket + 1)
-        {
-            double p_final = configs.momentum_mesh_points[idx_mom_bra];
-            double p_initial = configs.momentum_mesh_points[idx_mom_ket];
-            double v_value = interaction_all::potential_chiral(l_final, l_initial, s, j, tz, p_final, p_initial, configs);
-            fp << std::fixed << " " << std::scientific << std::setprecision(17) << v_value;
-        }
-        fp << "\n";
-    }
-    fp.close();
-
-    // pack binary file from txt file.
-    std::ostringstream oss_bin;
-    oss_bin << configs.result_dir << "kernel-" << configs.result_name << "-" << l_final << "-" << l_initial << "-" << s << "-" << j << "-" << tz_name << ".bin";
-    auto file_bin_name_this_channel = oss_bin.str();
-    pack_kernel_file(file_txt_name_this_channel, file_bin_name_this_channel, configs.mesh_points_number * configs.mesh_points_number);
-    std::cout << "writing: " << file_bin_name_this_channel << std::endl;
-}
 
-// write results in the output file.
-void write_dat(const NN::NN_configs &configs)
-{
-    // write momentum mesh.
-    std::ostringstream oss_mom_mesh;
-    oss_mom_mesh << configs.result_dir << configs.result_name << "-momentum-mesh.txt";
-    auto file_mom_mesh = oss_mom_mesh.str();
-    std::ofstream fp_mom_mesh(file_mom_mesh);
-    fp_mom_mesh << "# momentum mesh points number;\n";
-    fp_mom_mesh << "# momentum mesh points and weights;\n";
-    fp_mom_mesh << configs.mesh_points_number << "\n";
-    for (size_t i = 0; i < configs.momentum_mesh_points.size(); i = i + 1)
+    //---- answer requests on stdin with kernels on stdout, keeping the pion-exchange part between requests.
+    if (run_mode == "--serve")
     {
-        fp_mom_mesh << std::fixed << std::scientific << std::setprecision(17) << configs.momentum_mesh_points[i] << "\t" << std::setw(17) << configs.momentum_mesh_weights[i] << std::endl;
+        omp_set_max_active_levels(1);
+        service::run(argc > 2 ? argv[2] : "inifile-cms.ini", 16);
+        return 0;
     }
-    fp_mom_mesh.close();
-
-    // write partial-waves.
-    std::ostringstream oss_pws;
-    oss_pws << configs.result_dir << configs.result_name << "-partial-waves.txt";
-    auto file_pws = oss_pws.str();
-    std::ofstream fp_pws(file_pws);
-    fp_pws << "# partial-waves: l' l s j tz;\n";
-    for (size_t i = 0; i < configs.partial_waves.size(); i = i + 1)
-    {
-        fp_pws << configs.partial_waves[i][0] << " " << configs.partial_waves[i][1] << " " << configs.partial_waves[i][2] << " " << configs.partial_waves[i][3] << " " << configs.partial_waves[i][4] << "\n";
-    }
-    fp_pws.close();
 
-    // generate channels.
-    auto channels = configs.partial_waves;
-    for (size_t idx_channel = 0; idx_channel < channels.size(); idx_channel = idx_channel + 1)
-    {
-        // write matrix elements for each channel.
-        auto this_channel = channels[idx_channel];
-        write_dat_single_channel(this_channel, configs);
-    }
-}
-
-int main()
-{
     std::cout << "---- running NN-cms...\n\n";
 
     //---- print current date.
@@ -130,6 +44,18 @@ int main()
     std::cout << "---- current Date: " << dateStr << "\n"
               << std::endl;
 
+    //---- all variants of a manifest in this process, sharing the pion-exchange part where possible.
+    if (run_mode == "--manifest")
+    {
+        omp_set_max_active_levels(1);
+        auto start = std::chrono::high_resolution_clock::now();
+        manifest::run(argv[2]);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout.precision(4);
+        std::cout << "\nduration: " << std::chrono::duration<double>(end - start).count() << " seconds\n";
+        return 0;
+    }
+
     //---- config file initializing.
     auto ini = inifile_system::inifile("inifile-cms.ini");
     if (!ini.good())
@@ -137,6 +63,13 @@ int main()
         std::cerr << ini.error() << std::endl;
         exit(-1);
     }
+
+    //---- validate the channels and estimate time, memory and disk of the run, without writing kernels.
+    if (run_mode == "--plan")
+    {
+        return planner::run(ini) == 0 ? 0 : 1;
+    }
+
     auto configs = NN::NN_configs(ini);
     std::cout << "---- output file is written in: " << configs.result_dir << "kernel-" << configs.result_name << "-ll-l-s-j-tzname.txt & .bin" << std::endl;
     std::cout << "                                " << configs.result_dir << configs.result_name << "-momentum-mesh.txt" << std::endl;
@@ -144,18 +77,97 @@ int main()
               << std::endl;
 
     //---- set parallel threads in openpm, shouldn't too large.
-    const size_t thread_number = 16;
+    const size_t thread_number = configs.thread_number;
     std::cout << "---- number of threads for openmp: " << thread_number << "\n"
               << std::endl;
     omp_set_num_threads(thread_number);
 
+    //---- compare the optimized evaluation paths with the reference and stop.
+    if (run_mode == "--check-equivalence")
+    {
+        auto failures = equivalence::run(configs, equivalence::read_settings(ini));
+        return failures == 0 ? 0 : 1;
+    }
+
+    //---- per-channel error of the reduced precision paths and stop.
+    if (run_mode == "--precision-report")
+    {
+        auto sec = ini.section("numerical-parameters");
+        double tolerance = sec.has_key("precision_tolerance") ? sec.get_double("precision_tolerance") : 1e-7;
+        equivalence::precision_report(configs, tolerance, 1e-10);
+        return 0;
+    }
+
+    //---- phase shifts of the channel tables at the energies of table_tlabs.txt, without writing kernels.
+    if (run_mode == "--phase-shifts")
+    {
+        omp_set_max_active_levels(1);
+        phase_shifts::run(ini, configs);
+        return 0;
+    }
+
+    //---- deuteron from the j = 1 np kernels in memory, without writing kernels.
+    if (run_mode == "--deuteron")
+    {
+        return bound_state::run(ini, configs);
+    }
+
+    //---- srg evolution of the kernels to the lambdas of [srg], written like a normal run.
+    if (run_mode == "--srg")
+    {
+        omp_set_max_active_levels(1);
+        srg::run(ini, configs);
+        return 0;
+    }
+
+    //---- relative oscillator matrix elements at the hbar_omegas of [ho].
+    if (run_mode == "--ho")
+    {
+        omp_set_max_active_levels(1);
+        ho_transform::run(ini, configs);
+        return 0;
+    }
+
+    //---- kernels of the run of [remesh] interpolated onto the momentum mesh, exact where the estimate is too large.
+    if (run_mode == "--remesh")
+    {
+        omp_set_max_active_levels(1);
+        remesh::run(ini, configs);
+        return 0;
+    }
+
+    //---- optional per-stage instrumentation.
+    if (configs.run_report)
+    {
+        std::vector<std::string> channel_names;
+        for (const auto &channel : configs.partial_waves)
+        {
+            channel_names.push_back(kernel_output::channel_tag(channel));
+        }
+        profiler::start(channel_names);
+    }
+
     auto start = std::chrono::high_resolution_clock::now();
 
     //---- main program:
-    write_dat(configs);
+    kernel_output::write_dat(configs);
 
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::seconds>(end - start);
     std::cout.precision(4);
     std::cout << "\nduration: " << duration.count() << " seconds\n";
+
+    if (configs.run_report)
+    {
+        std::string file_report = configs.result_dir + configs.result_name + "-run-report.json";
+        double wall_seconds = std::chrono::duration<double>(end - start).count();
+        profiler::write_report(file_report, wall_seconds, thread_number, configs.mesh_points_number, configs.angular_mesh_number);
+        std::cout << "run report written in: " << file_report << std::endl;
+    }
+}
+catch (const std::exception &e)
+{
+    //---- invalid settings end the run with their message.
+    std::cerr << e.what() << std::endl;
+    exit(-1);
 }
\ No newline at end of file
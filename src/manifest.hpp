@@ -0,0 +1,241 @@
+#pragma once
+#ifndef MANIFEST_HPP
+#define MANIFEST_HPP
+
+#include "kernel_output.hpp"
+#include "lib_define.hpp"
+
+// many interaction variants in one process, "NN-cms.x --manifest file.ini".
+// every section of the manifest except [manifest] is one variant, named by the section, with overrides
+// "section.key = value" of the base ini file given by "base" in [manifest]. the result_name of a variant
+// defaults to its name. variants that only differ in the contact terms share the pion-exchange part:
+// it is integrated over the angle once per element and added to the contact terms of every variant.
+// overrides must name keys of the base ini file. variants write the plain kernel files only, shm_name,
+// tiled_output and derivatives are refused.
+namespace manifest
+{
+    struct variant
+    {
+        std::string name;
+        NN::NN_configs configs;
+    };
+
+    // read the manifest and set up the configs of all variants.
+    std::vector<variant> read_variants(const std::string &file_manifest)
+    {
+        auto ini_manifest = inifile_system::inifile(file_manifest);
+        if (!ini_manifest.good())
+        {
+            std::cerr << ini_manifest.error() << std::endl;
+            exit(-1);
+        }
+        std::string file_base = "inifile-cms.ini";
+        if (ini_manifest.has_section("manifest") && ini_manifest.section("manifest").has_key("base"))
+        {
+            file_base = ini_manifest.section("manifest").get_string("base");
+        }
+        auto ini_base = inifile_system::inifile(file_base);
+        if (!ini_base.good())
+        {
+            std::cerr << ini_base.error() << std::endl;
+            exit(-1);
+        }
+
+        std::vector<variant> variants;
+        for (const auto &name : ini_manifest.section_names())
+        {
+            if (name == "manifest")
+            {
+                continue;
+            }
+            auto ini = ini_base;
+            ini.section("output").set_string("result_name", name);
+            for (const auto &item : ini_manifest.section(name).items)
+            {
+                auto pos = item.key.find('.');
+                if (pos == std::string::npos)
+                {
+                    std::cerr << "variant " << name << ": override " << item.key << " needs the form section.key" << std::endl;
+                    exit(-1);
+                }
+                std::string section_name = item.key.substr(0, pos);
+                std::string key = item.key.substr(pos + 1);
+                if (!ini_base.has_section(section_name) || !ini_base.section(section_name).has_key(key))
+                {
+                    std::cerr << "variant " << name << ": key not in the base ini file: " << item.key << std::endl;
+                    exit(-1);
+                }
+                ini.section(section_name).set_string(key, item.value);
+            }
+            NN::NN_configs configs(ini);
+            if (!configs.shm_name.empty() || configs.tiled_output || !configs.derivatives.empty())
+            {
+                std::cerr << "variant " << name << ": shm_name, tiled_output and derivatives are not supported by --manifest" << std::endl;
+                exit(-1);
+            }
+            variants.push_back({name, configs});
+        }
+        if (variants.empty())
+        {
+            std::cerr << "no variants in manifest: " << file_manifest << std::endl;
+            exit(-1);
+        }
+        return variants;
+    }
+
+    // true if the pion-exchange part, the normalization and the meshes of "a" and "b" are the same, so that
+    // the two only differ in their contact terms and output settings.
+    bool same_pion_exchange(const NN::NN_configs &a, const NN::NN_configs &b)
+    {
+        return a.axial_current_coupling_constant == b.axial_current_coupling_constant && a.pion_decay_constant == b.pion_decay_constant &&
+               a.c1 == b.c1 && a.c2 == b.c2 && a.c3 == b.c3 && a.c4 == b.c4 &&
+               a.d1_plus_d2 == b.d1_plus_d2 && a.d3 == b.d3 && a.d5 == b.d5 && a.d14_minus_d15 == b.d14_minus_d15 &&
+               a.Lambda == b.Lambda && a.Lambda_tilde == b.Lambda_tilde && a.chiral_order_index == b.chiral_order_index &&
+               a.n_reg_one_pion_exchange == b.n_reg_one_pion_exchange && a.n_reg_two_pion_exchange_nlo == b.n_reg_two_pion_exchange_nlo &&
+               a.n_reg_two_pion_exchange_n2lo == b.n_reg_two_pion_exchange_n2lo && a.n_reg_two_pion_exchange_n3lo == b.n_reg_two_pion_exchange_n3lo &&
+               a.mass_pion_charged == b.mass_pion_charged && a.mass_pion_neutral == b.mass_pion_neutral && a.mass_pion_averaged == b.mass_pion_averaged &&
+               a.mass_nucleon == b.mass_nucleon && a.momentum_mesh_points == b.momentum_mesh_points &&
+               a.angular_mesh_points == b.angular_mesh_points && a.angular_mesh_weights == b.angular_mesh_weights && a.partial_waves == b.partial_waves &&
+               a.ope_projection == b.ope_projection && a.tpe_projection == b.tpe_projection &&
+               (a.tpe_projection != "spectral" || a.tpe_spectral_points == b.tpe_spectral_points);
+    }
+
+    // variants evaluated in double precision with the fixed angular mesh and without screening can share the
+    // pion-exchange part, the others are written one by one.
+    bool shareable(const NN::NN_configs &configs)
+    {
+        return configs.precision == "double" && configs.angular_mode == "fixed" && !configs.screening;
+    }
+
+    // groups of variant indices with the same pion-exchange part.
+    std::vector<std::vector<size_t>> make_groups(const std::vector<variant> &variants)
+    {
+        std::vector<std::vector<size_t>> groups;
+        for (size_t idx = 0; idx < variants.size(); idx = idx + 1)
+        {
+            bool found = false;
+            for (auto &group : groups)
+            {
+                const auto &lead = variants[group[0]].configs;
+                if (shareable(lead) && shareable(variants[idx].configs) && same_pion_exchange(lead, variants[idx].configs))
+                {
+                    group.push_back(idx);
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
+            {
+                groups.push_back({idx});
+            }
+        }
+        return groups;
+    }
+
+    // pion-exchange part of one channel, row-major, without normalization, with the terms projected in closed form.
+    // the elements are distributed over the threads.
+    std::vector<double> pion_exchange_matrix(const std::vector<int> &this_channel, const NN::NN_configs &configs)
+    {
+        size_t n = configs.mesh_points_number;
+        std::vector<double> v_pion_exchange(n * n);
+#pragma omp parallel for schedule(dynamic)
+        for (size_t idx_element = 0; idx_element < n * n; idx_element = idx_element + 1)
+        {
+            double p_final = configs.momentum_mesh_points[idx_element / n];
+            double p_initial = configs.momentum_mesh_points[idx_element % n];
+            v_pion_exchange[idx_element] = interaction_all::potential_pion_exchange<double>(this_channel[0], this_channel[1], this_channel[2], this_channel[3], this_channel[4],
+                                                                                                   p_final, p_initial, configs, configs.angular_mesh_points, configs.angular_mesh_weights) +
+                                     interaction_all::potential_pion_exchange_projected<double>(this_channel[0], this_channel[1], this_channel[2], this_channel[3], this_channel[4],
+                                                                                                       p_final, p_initial, configs);
+        }
+        return v_pion_exchange;
+    }
+
+    // full matrix of one channel from the shared pion-exchange part and the contact terms of "configs".
+    std::vector<double> add_contact(const std::vector<int> &this_channel, const NN::NN_configs &configs, const std::vector<double> &v_pion_exchange)
+    {
+        size_t n = configs.mesh_points_number;
+        std::vector<double> v(n * n);
+#pragma omp parallel for schedule(static)
+        for (size_t idx_element = 0; idx_element < n * n; idx_element = idx_element + 1)
+        {
+            double p_final = configs.momentum_mesh_points[idx_element / n];
+            double p_initial = configs.momentum_mesh_points[idx_element % n];
+            double temp = interaction_all::potential_contact<double>(this_channel[0], this_channel[1], this_channel[2], this_channel[3], this_channel[4], p_final, p_initial, configs);
+            temp = temp + v_pion_exchange[idx_element];
+            // apply a relativity-factor and a normalization constant (2Pi)^3.
+            v[idx_element] = temp * interaction_all::relativity_factor(p_final, p_initial, configs) / interaction_all::twopicubic;
+        }
+        return v;
+    }
+
+    // write all channels of one group.
+    void write_group(const std::vector<variant> &variants, const std::vector<size_t> &group)
+    {
+        const auto &lead = variants[group[0]].configs;
+        // the threads of the first variant serve the whole group.
+        omp_set_num_threads(lead.thread_number);
+        for (auto idx : group)
+        {
+            kernel_output::write_mesh_and_partial_waves(variants[idx].configs);
+        }
+        if (!shareable(lead))
+        {
+            std::vector<screening::plan> screens;
+            if (lead.screening)
+            {
+                screens = screening::make_plans(lead);
+                screening::print_summary(screens);
+            }
+            kernel_output::kernel_writer writer(lead);
+            for (size_t idx_channel = 0; idx_channel < lead.partial_waves.size(); idx_channel = idx_channel + 1)
+            {
+                writer.add(idx_channel, kernel_output::compute_channel(lead.partial_waves[idx_channel], lead, screens.empty() ? nullptr : &screens[idx_channel]));
+            }
+            return;
+        }
+
+        std::vector<kernel_output::kernel_writer> writers;
+        for (auto idx : group)
+        {
+            writers.emplace_back(variants[idx].configs);
+        }
+        for (size_t idx_channel = 0; idx_channel < lead.partial_waves.size(); idx_channel = idx_channel + 1)
+        {
+            const auto &this_channel = lead.partial_waves[idx_channel];
+            auto v_pion_exchange = pion_exchange_matrix(this_channel, lead);
+            for (size_t idx_group = 0; idx_group < group.size(); idx_group = idx_group + 1)
+            {
+                const auto &configs = variants[group[idx_group]].configs;
+                writers[idx_group].add(idx_channel, add_contact(this_channel, configs, v_pion_exchange));
+            }
+        }
+    }
+
+    // run all variants of the manifest, returns the number of variants.
+    size_t run(const std::string &file_manifest)
+    {
+        auto variants = read_variants(file_manifest);
+        auto groups = make_groups(variants);
+        std::cout << "---- manifest: " << variants.size() << " variants in " << groups.size() << " pion-exchange groups\n";
+        for (const auto &group : groups)
+        {
+            std::cout << "    ";
+            for (auto idx : group)
+            {
+                std::cout << " " << variants[idx].name;
+            }
+            std::cout << "\n";
+        }
+        std::cout << std::endl;
+
+        for (const auto &group : groups)
+        {
+            write_group(variants, group);
+        }
+        return variants.size();
+    }
+
+} // namespace manifest
+
+#endif // MANIFEST_HPP
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef MOMENTUM_MESH_HPP
+#define MOMENTUM_MESH_HPP
+
+#include "basic_math.hpp"
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// momentum meshes on [0, p_max], built from gauss-legendre rules in [-1, 1] and a map x -> p.
+// "linear" spreads the points evenly, "tangent" and "hyperbolic" cluster them below the scale "c", where the
+// regulated kernels vary most, "segments" joins linear rules on consecutive intervals. truncated at p_max, the
+// maps put half of the points below c tan(theta_max / 2) and c / (1 + 2 c / p_max); both tend to c only for
+// p_max >> c (327 and 267 MeV for c = 500 and p_max = 1146 MeV).
+namespace momentum_mesh
+{
+    struct mesh
+    {
+        std::vector<double> points;
+        std::vector<double> weights;
+    };
+
+    // p = p_min + (p_max - p_min) (1 + x) / 2.
+    mesh linear(size_t n, double p_min, double p_max)
+    {
+        const auto &rule = basic_math::gauss_legendre_rule(n, p_min, p_max);
+        return {rule.nodes, rule.weights};
+    }
+
+    // p = c tan(theta), theta = theta_max (1 + x) / 2, theta_max = atan(p_max / c), maps 0 -> c tan(theta_max / 2).
+    mesh tangent(size_t n, double c, double p_max)
+    {
+        mesh m;
+        const auto &rule = basic_math::gauss_legendre_rule(n);
+        double theta_max = std::atan(p_max / c);
+        for (size_t i = 0; i < n; i = i + 1)
+        {
+            double theta = 0.5 * theta_max * (1.0 + rule.nodes[i]);
+            double cos_theta = std::cos(theta);
+            m.points.push_back(c * std::tan(theta));
+            m.weights.push_back(0.5 * theta_max * c / (cos_theta * cos_theta) * rule.weights[i]);
+        }
+        return m;
+    }
+
+    // p = c (1 + x) / (1 - x + 2 c / p_max), maps -1 -> 0, 0 -> c / (1 + 2 c / p_max), 1 -> p_max.
+    mesh hyperbolic(size_t n, double c, double p_max)
+    {
+        mesh m;
+        const auto &rule = basic_math::gauss_legendre_rule(n);
+        double d = 2.0 * c / p_max;
+        for (size_t i = 0; i < n; i = i + 1)
+        {
+            double x = rule.nodes[i];
+            double den = 1.0 - x + d;
+            m.points.push_back(c * (1.0 + x) / den);
+            m.weights.push_back(c * (2.0 + d) / (den * den) * rule.weights[i]);
+        }
+        return m;
+    }
+
+    // linear rules with "counts[i]" points on [bounds[i], bounds[i + 1]].
+    mesh segments(const std::vector<double> &bounds, const std::vector<size_t> &counts)
+    {
+        mesh m;
+        for (size_t i = 0; i + 1 < bounds.size(); i = i + 1)
+        {
+            auto segment = linear(counts[i], bounds[i], bounds[i + 1]);
+            m.points.insert(m.points.end(), segment.points.begin(), segment.points.end());
+            m.weights.insert(m.weights.end(), segment.weights.begin(), segment.weights.end());
+        }
+        return m;
+    }
+
+    // momentum where the slowest regulator exp(-(p / lambda)^(2 n)) has dropped to "tolerance".
+    double auto_p_max(double lambda, size_t n_min, double tolerance)
+    {
+        return lambda * std::pow(-std::log(tolerance), 1.0 / (2.0 * n_min));
+    }
+
+} // namespace momentum_mesh
+
+#endif // MOMENTUM_MESH_HPP
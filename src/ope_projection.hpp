@@ -0,0 +1,125 @@
+#pragma once
+#ifndef OPE_PROJECTION_HPP
+#define OPE_PROJECTION_HPP
+
+#include "interaction_aPWD.hpp"
+#include "lib_define.hpp"
+
+// closed-form partial-wave projection of the one-pion exchange, switched on by "ope_projection = analytic".
+// with q^2 + m^2 = 2 p' p (z - x), z = (p'^2 + p^2 + m^2) / (2 p' p), the one-pion exchange is f6 = c / (2 p' p (z - x)),
+// and the aPWD expression of a channel with f6 = 1 is a polynomial c(x) of low degree. expanded in legendre polynomials,
+// c(x) = sum_k a_k P_k(x), the projection is
+//     int dx c(x) / (z - x) = 2 sum_k a_k Q_k(z),
+// with the legendre functions of the second kind Q_k. the a_k are exact with a gauss-legendre rule of j + 6 points,
+// the Q_k of every pion mass come from one backward recurrence, so there is no angular quadrature error.
+namespace ope_projection
+{
+    // legendre functions of the second kind Q_0 .. Q_l_max at z > 1 in "q". Q_k is the minimal solution of its
+    // recurrence, so it is computed downwards (miller's method) from deep enough that the start value has decayed,
+    // and normalized to Q_0 = atanh(1 / z).
+    template <typename T>
+    void legendre_q(const T &z, int l_max, std::vector<T> &q)
+    {
+        using std::log1p;
+        double zd = static_cast<double>(z);
+        double rate = std::log(zd + std::sqrt(zd * zd - 1.0)); // |Q_k+1 / Q_k| -> exp(-rate).
+        int start = l_max + 2 + static_cast<int>(std::min(1e5, std::ceil(40.0 / rate)));
+        q.assign(l_max + 1, T(0.0));
+        T q_next = T(0.0), q_this = T(1e-30);
+        for (int k = start; k > 0; k = k - 1)
+        {
+            // Q_k-1 = ((2k + 1) z Q_k - (k + 1) Q_k+1) / k.
+            T q_previous = (T(2.0 * k + 1.0) * z * q_this - T(k + 1.0) * q_next) / T(k);
+            q_next = q_this;
+            q_this = q_previous;
+            if (k - 1 <= l_max)
+            {
+                q[k - 1] = q_this;
+            }
+            if (std::fabs(static_cast<double>(q_this)) > 1e30)
+            {
+                // rescale the running values and the stored ones.
+                q_next = q_next * T(1e-30);
+                q_this = q_this * T(1e-30);
+                for (int i = k - 1; i <= l_max; i = i + 1)
+                {
+                    q[i] = q[i] * T(1e-30);
+                }
+            }
+        }
+        T scale = T(0.5) * log1p(T(2.0) / (z - T(1.0))) / q[0];
+        for (auto &value : q)
+        {
+            value = value * scale;
+        }
+    }
+
+    // legendre coefficients a_0 .. a_(j+4) of the aPWD polynomial c(x) of the channel with f6 = 1, or with the
+    // f-component "component" (0 .. 5) = 1.
+    template <typename T>
+    std::vector<T> legendre_coefficients(const int &l_final, const int &l_initial, const int &s, const int &j, const T &p_final, const T &p_initial, int component = 5)
+    {
+        const auto &rule = basic_math::gauss_legendre_rule(j + 6);
+        int k_max = j + 4;
+        std::vector<T> a(k_max + 1, T(0.0));
+        std::vector<T> unit(6, T(0.0));
+        unit[component] = T(1.0);
+        for (size_t g = 0; g < rule.nodes.size(); g = g + 1)
+        {
+            double x = rule.nodes[g];
+            T c = interaction_aPWD::potential_auto(l_final, l_initial, s, j, p_final, p_initial, T(x), unit) * T(rule.weights[g]);
+            double p_previous = 0.0, p_this = 1.0;
+            for (int k = 0; k <= k_max; k = k + 1)
+            {
+                a[k] = a[k] + T(0.5 * (2.0 * k + 1.0) * p_this) * c;
+                double p_next = ((2.0 * k + 1.0) * x * p_this - k * p_previous) / (k + 1.0);
+                p_previous = p_this;
+                p_this = p_next;
+            }
+        }
+        return a;
+    }
+
+    // int dx c(x) / (q^2 + m^2) of the channel polynomial with the legendre coefficients "a".
+    template <typename T>
+    T propagator_projection(const std::vector<T> &a, const T &p_final, const T &p_initial, const T &mass, std::vector<T> &q)
+    {
+        T two_pp = T(2.0) * p_final * p_initial;
+        T z = (p_final * p_final + p_initial * p_initial + mass * mass) / two_pp;
+        legendre_q(z, int(a.size()) - 1, q);
+        T sum = T(0.0);
+        for (size_t k = 0; k < a.size(); k = k + 1)
+        {
+            sum = sum + a[k] * q[k];
+        }
+        return T(2.0) * sum / two_pp;
+    }
+
+    // projected one-pion exchange of one channel, the same term as the angular integration of
+    // potential_one_pion_exchange, without normalization.
+    template <typename T>
+    T potential(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const T &p_final, const T &p_initial, const NN::NN_configs &configs)
+    {
+        T ga = interaction_aPWD::parameter<T>(configs.axial_current_coupling_constant, dual_numbers::ga, configs);
+        T fpi = interaction_aPWD::parameter<T>(configs.pion_decay_constant, dual_numbers::fpi, configs);
+        T mpi_neutral = interaction_aPWD::parameter<T>(configs.mass_pion_neutral, dual_numbers::mpi_neutral, configs);
+        T mpi_charged = interaction_aPWD::parameter<T>(configs.mass_pion_charged, dual_numbers::mpi_charged, configs);
+        T frefactor = -ga * ga / T(4.0) / (fpi * fpi);
+        T regulator = interaction_aPWD::regulator_function(p_initial, p_final, configs.n_reg_one_pion_exchange, configs);
+
+        auto a = legendre_coefficients(l_final, l_initial, s, j, p_final, p_initial);
+        std::vector<T> q;
+        T neutral = propagator_projection(a, p_final, p_initial, mpi_neutral, q);
+        T projected = neutral;
+        if (tz == 0)
+        {
+            // total isospin I = 1 or 0, with the charged pion.
+            T charged = propagator_projection(a, p_final, p_initial, mpi_charged, q);
+            projected = (l_initial + s) % 2 == 0 ? -neutral + T(2.0) * charged : -neutral - T(2.0) * charged;
+        }
+        return frefactor * projected * regulator;
+    }
+
+} // namespace ope_projection
+
+#endif // OPE_PROJECTION_HPP
@@ -0,0 +1,502 @@
+#pragma once
+#ifndef PHASE_SHIFTS_HPP
+#define PHASE_SHIFTS_HPP
+
+#include "kernel_output.hpp"
+#include "linear_algebra.hpp"
+#include "lib_define.hpp"
+#include <numeric>
+
+// "NN-cms.x --phase-shifts": phase shifts and mixing angles of the channel tables at the lab energies of
+// table_tlabs.txt, from the lippmann-schwinger equation for the K matrix in the normalization of the kernels,
+//     K(p', q) = V(p', q) + P int dk k^2 V(p', k) 2mu / (q^2 - k^2) K(k, q),    tan(delta) = -pi mu q K(q, q),
+// with mu the reduced mass of the channel and q the c.m. momentum of tlab (NN_configs::get_rel_mom).
+// the principal value is taken with the subtraction of haftel and tabakin on the momentum mesh, with the
+// on-shell point q as an extra point: the mesh kernels are computed once per channel, the elements of the
+// extra row and column directly per energy. the (channel, energy) pairs are distributed over the threads.
+// with "derivatives" in [output], the derivatives of the phase shifts are solved from the same lu factors,
+//     (1 - V u) dK = dV + dV u K,
+// with the kernel derivatives of the dual evaluation, and written per parameter like the phase shifts.
+namespace phase_shifts
+{
+    struct settings
+    {
+        std::string tlab_file;  // lab energies in MeV, one per line.
+        std::string convention; // of the coupled channels: "stapp" (bar phase shifts) or "blatt" (eigen phase shifts).
+    };
+
+    // optional [phase-shifts] section.
+    settings read_settings(const inifile_system::inifile &ini)
+    {
+        settings st{"table_tlabs.txt", "stapp"};
+        if (ini.has_section("phase-shifts"))
+        {
+            auto sec = ini.section("phase-shifts");
+            st.tlab_file = sec.has_key("tlab_file") ? sec.get_string("tlab_file") : st.tlab_file;
+            st.convention = sec.has_key("convention") ? sec.get_string("convention") : st.convention;
+        }
+        if (st.convention != "stapp" && st.convention != "blatt")
+        {
+            std::cerr << "unknown phase-shift convention: " << st.convention << " (stapp or blatt)" << std::endl;
+            exit(-1);
+        }
+        return st;
+    }
+
+    // lab energies of the table in increasing order, skipping "#" comments.
+    std::vector<double> read_tlabs(const std::string &fname)
+    {
+        std::ifstream file(fname);
+        if (!file.is_open())
+        {
+            std::cerr << "failed to open file: " << fname << std::endl;
+            exit(-1);
+        }
+        std::vector<double> tlabs;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::istringstream iss(line);
+            double tlab;
+            if (line.empty() || line[0] == '#' || !(iss >> tlab))
+            {
+                continue;
+            }
+            if (tlab <= 0.0)
+            {
+                std::cerr << "tlab must be positive: " << tlab << std::endl;
+                exit(-1);
+            }
+            tlabs.push_back(tlab);
+        }
+        std::sort(tlabs.begin(), tlabs.end());
+        return tlabs;
+    }
+
+    // twice the reduced mass of the two nucleons of "tz".
+    double twice_reduced_mass(int tz, const NN::NN_configs &configs)
+    {
+        if (tz == -1)
+        {
+            return configs.mass_proton;
+        }
+        if (tz == 1)
+        {
+            return configs.mass_neutron;
+        }
+        return 2.0 * configs.mass_proton * configs.mass_neutron / (configs.mass_proton + configs.mass_neutron);
+    }
+
+    // an uncoupled channel, or the four channels [--, -+, +-, ++] of a coupled (j, tz), with their mesh kernels
+    // and their derivatives with respect to configs.derivatives, [parameter][channel].
+    struct channel_group
+    {
+        std::vector<std::vector<int>> channels;
+        std::vector<std::vector<double>> kernels;
+        std::vector<std::vector<std::vector<double>>> kernel_derivatives;
+    };
+
+    // groups of the channel tables, without the pp and nn channels forbidden by the pauli principle.
+    std::vector<channel_group> make_groups(const NN::NN_configs &configs)
+    {
+        std::vector<channel_group> groups;
+        const auto &channels = configs.partial_waves;
+        for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+        {
+            channel_group group;
+            size_t size = kernel_output::coupled_group(channels, idx) ? 4 : 1;
+            group.channels.assign(channels.begin() + idx, channels.begin() + idx + size);
+            idx = idx + size - 1;
+            const auto &c = group.channels[0];
+            if (c[4] != 0 && (c[1] + c[2]) % 2 != 0)
+            {
+                std::cout << "skipping " << kernel_output::channel_tag(c) << ": Pauli forbidden for pp and nn\n";
+                continue;
+            }
+            groups.push_back(group);
+        }
+        return groups;
+    }
+
+    // a = identity - V u of the system of the mesh kernels "kernels" and the half-shell columns "column", with
+    // V(q, p_k) = V_ba(p_k, q) from time-reversal symmetry, and the on-shell columns as right-hand sides "rhs".
+    void assemble(const std::vector<std::vector<double>> &kernels, const std::vector<std::vector<double>> &column, const std::vector<double> &u, size_t n, size_t m,
+                  double identity, std::vector<double> &a, std::vector<std::vector<double>> &rhs)
+    {
+        size_t dim = m * (n + 1);
+        a.assign(dim * dim, 0.0);
+        rhs.assign(m, std::vector<double>(dim));
+        for (size_t ia = 0; ia < m; ia = ia + 1)
+        {
+            for (size_t i = 0; i <= n; i = i + 1)
+            {
+                size_t row = ia * (n + 1) + i;
+                for (size_t ib = 0; ib < m; ib = ib + 1)
+                {
+                    const auto &kernel = kernels[ia * m + ib];
+                    double *a_row = a.data() + row * dim + ib * (n + 1);
+                    for (size_t k = 0; k < n; k = k + 1)
+                    {
+                        double v = i < n ? kernel[i * n + k] : column[ib * m + ia][k];
+                        a_row[k] = -v * u[k];
+                    }
+                    a_row[n] = -column[ia * m + ib][i] * u[n];
+                    rhs[ib][row] = column[ia * m + ib][i];
+                }
+                a[row * dim + row] += identity;
+            }
+        }
+    }
+
+    // on-shell K matrix (1 x 1 or 2 x 2, row-major) of "group" at c.m. momentum "q", and its derivatives with
+    // respect to configs.derivatives in "k_derivatives" if the group has kernel derivatives.
+    // the system has the mesh points and q for each of the m = 1 or 2 orbital momenta, index a * (n + 1) + i.
+    std::vector<double> on_shell_k_matrix(const channel_group &group, double q, const NN::NN_configs &configs, std::vector<std::vector<double>> &k_derivatives)
+    {
+        size_t n = configs.mesh_points_number;
+        size_t m = group.channels.size() == 4 ? 2 : 1;
+        size_t dim = m * (n + 1);
+        const auto &p = configs.momentum_mesh_points;
+        const auto &w = configs.momentum_mesh_weights;
+        double mu2 = twice_reduced_mass(group.channels[0][4], configs);
+
+        size_t parameters = group.kernel_derivatives.size();
+
+        // half-shell elements V_ab(p_i, q) with p_n = q, one column per block ab, and their derivatives.
+        std::vector<std::vector<double>> column(m * m, std::vector<double>(n + 1));
+        std::vector<std::vector<std::vector<double>>> column_derivatives(parameters, column);
+        for (size_t ab = 0; ab < m * m; ab = ab + 1)
+        {
+            const auto &c = group.channels[ab];
+            for (size_t i = 0; i <= n; i = i + 1)
+            {
+                if (parameters == 0)
+                {
+                    column[ab][i] = interaction_all::potential_element(c[0], c[1], c[2], c[3], c[4], i < n ? p[i] : q, q, configs);
+                    continue;
+                }
+                dual_numbers::dual element = interaction_all::potential_chiral<dual_numbers::dual>(c[0], c[1], c[2], c[3], c[4], i < n ? p[i] : q, q, configs);
+                column[ab][i] = element.v;
+                for (size_t idx_parameter = 0; idx_parameter < parameters; idx_parameter = idx_parameter + 1)
+                {
+                    column_derivatives[idx_parameter][ab][i] = element.d[configs.derivatives[idx_parameter]];
+                }
+            }
+        }
+
+        // propagator weights with the principal-value subtraction, int_0^p_max dk / (q^2 - k^2) is analytic.
+        double p_max = std::accumulate(w.begin(), w.end(), 0.0);
+        std::vector<double> u(n + 1);
+        double subtraction = 0.0;
+        for (size_t k = 0; k < n; k = k + 1)
+        {
+            u[k] = mu2 * w[k] * p[k] * p[k] / (q * q - p[k] * p[k]);
+            subtraction += w[k] / (q * q - p[k] * p[k]);
+        }
+        u[n] = -mu2 * q * q * (subtraction - std::log((p_max + q) / (p_max - q)) / (2.0 * q));
+
+        std::vector<double> a;
+        std::vector<std::vector<double>> rhs;
+        assemble(group.kernels, column, u, n, m, 1.0, a, rhs);
+
+        std::vector<size_t> pivot;
+        k_derivatives.assign(parameters, std::vector<double>(m * m, std::nan("")));
+        if (!linear_algebra::lu_factorize(a, dim, pivot))
+        {
+            return std::vector<double>(m * m, std::nan(""));
+        }
+        std::vector<double> k_matrix(m * m);
+        for (size_t ib = 0; ib < m; ib = ib + 1)
+        {
+            linear_algebra::lu_solve(a, dim, pivot, rhs[ib]);
+            for (size_t ia = 0; ia < m; ia = ia + 1)
+            {
+                k_matrix[ia * m + ib] = rhs[ib][ia * (n + 1) + n];
+            }
+        }
+
+        // (1 - V u) dK = dV - (-dV u) K with the factors of 1 - V u, the solutions K are in rhs.
+        std::vector<double> da;
+        std::vector<std::vector<double>> drhs;
+        for (size_t idx_parameter = 0; idx_parameter < parameters; idx_parameter = idx_parameter + 1)
+        {
+            assemble(group.kernel_derivatives[idx_parameter], column_derivatives[idx_parameter], u, n, m, 0.0, da, drhs);
+            for (size_t ib = 0; ib < m; ib = ib + 1)
+            {
+                for (size_t row = 0; row < dim; row = row + 1)
+                {
+                    const double *da_row = da.data() + row * dim;
+                    drhs[ib][row] -= std::inner_product(da_row, da_row + dim, rhs[ib].begin(), 0.0);
+                }
+                linear_algebra::lu_solve(a, dim, pivot, drhs[ib]);
+                for (size_t ia = 0; ia < m; ia = ia + 1)
+                {
+                    k_derivatives[idx_parameter][ia * m + ib] = drhs[ib][ia * (n + 1) + n];
+                }
+            }
+        }
+        return k_matrix;
+    }
+
+    // phase shifts in degrees from the on-shell K matrix: delta, or delta(l=j-1), delta(l=j+1), epsilon.
+    std::vector<double> phases(const std::vector<double> &k_matrix, double q, double mu2, const std::string &convention)
+    {
+        const double deg = 180.0 / constants::pi;
+        // R = tan(delta) matrix.
+        std::vector<double> r(k_matrix.size());
+        for (size_t idx = 0; idx < r.size(); idx = idx + 1)
+        {
+            r[idx] = -0.5 * constants::pi * mu2 * q * k_matrix[idx];
+        }
+        if (r.size() == 1)
+        {
+            return {std::atan(r[0]) * deg};
+        }
+
+        // blatt-biedenharn: eigenphases of R and the angle of its eigenvectors.
+        double r11 = r[0], r12 = 0.5 * (r[1] + r[2]), r22 = r[3];
+        if (convention == "blatt")
+        {
+            double epsilon = 0.5 * std::atan2(2.0 * r12, r11 - r22);
+            if (epsilon > 0.25 * constants::pi)
+            {
+                epsilon -= 0.5 * constants::pi;
+            }
+            else if (epsilon < -0.25 * constants::pi)
+            {
+                epsilon += 0.5 * constants::pi;
+            }
+            double c = std::cos(epsilon), s = std::sin(epsilon);
+            double tan_minus = r11 * c * c + 2.0 * r12 * s * c + r22 * s * s;
+            double tan_plus = r11 * s * s - 2.0 * r12 * s * c + r22 * c * c;
+            return {std::atan(tan_minus) * deg, std::atan(tan_plus) * deg, epsilon * deg};
+        }
+
+        // stapp: S = (1 + iR)(1 - iR)^-1 = [[cos(2e) exp(2i d1), i sin(2e) exp(i(d1+d2))], [..., cos(2e) exp(2i d2)]].
+        using cd = std::complex<double>;
+        const cd i1(0.0, 1.0);
+        cd m11 = 1.0 - i1 * r11, m12 = -i1 * r12, m22 = 1.0 - i1 * r22;
+        cd det = m11 * m22 - m12 * m12;
+        cd inv11 = m22 / det, inv12 = -m12 / det, inv22 = m11 / det;
+        cd s11 = (1.0 + i1 * r11) * inv11 + i1 * r12 * inv12;
+        cd s12 = (1.0 + i1 * r11) * inv12 + i1 * r12 * inv22;
+        cd s22 = i1 * r12 * inv12 + (1.0 + i1 * r22) * inv22;
+        double delta_minus = 0.5 * std::arg(s11);
+        double delta_plus = 0.5 * std::arg(s22);
+        double sin_2epsilon = std::real(-i1 * s12 * std::exp(-i1 * (delta_minus + delta_plus)));
+        double epsilon = 0.5 * std::asin(std::clamp(sin_2epsilon, -1.0, 1.0));
+        return {delta_minus * deg, delta_plus * deg, epsilon * deg};
+    }
+
+    // derivatives of the phases of "phases" in degrees from the on-shell K matrix and its derivative "dk_matrix".
+    std::vector<double> phase_derivatives(const std::vector<double> &k_matrix, const std::vector<double> &dk_matrix, double q, double mu2, const std::string &convention)
+    {
+        const double deg = 180.0 / constants::pi;
+        std::vector<double> r(k_matrix.size()), dr(k_matrix.size());
+        for (size_t idx = 0; idx < r.size(); idx = idx + 1)
+        {
+            r[idx] = -0.5 * constants::pi * mu2 * q * k_matrix[idx];
+            dr[idx] = -0.5 * constants::pi * mu2 * q * dk_matrix[idx];
+        }
+        if (r.size() == 1)
+        {
+            return {dr[0] / (1.0 + r[0] * r[0]) * deg};
+        }
+
+        double r11 = r[0], r12 = 0.5 * (r[1] + r[2]), r22 = r[3];
+        double dr11 = dr[0], dr12 = 0.5 * (dr[1] + dr[2]), dr22 = dr[3];
+        if (convention == "blatt")
+        {
+            // the eigenvalues move by v^T dR v, the angle by the rotation that keeps R diagonal.
+            double epsilon = 0.5 * std::atan2(2.0 * r12, r11 - r22);
+            if (epsilon > 0.25 * constants::pi)
+            {
+                epsilon -= 0.5 * constants::pi;
+            }
+            else if (epsilon < -0.25 * constants::pi)
+            {
+                epsilon += 0.5 * constants::pi;
+            }
+            double c = std::cos(epsilon), s = std::sin(epsilon);
+            double tan_minus = r11 * c * c + 2.0 * r12 * s * c + r22 * s * s;
+            double tan_plus = r11 * s * s - 2.0 * r12 * s * c + r22 * c * c;
+            double dtan_minus = dr11 * c * c + 2.0 * dr12 * s * c + dr22 * s * s;
+            double dtan_plus = dr11 * s * s - 2.0 * dr12 * s * c + dr22 * c * c;
+            double depsilon = ((r11 - r22) * dr12 - r12 * (dr11 - dr22)) / ((r11 - r22) * (r11 - r22) + 4.0 * r12 * r12);
+            return {dtan_minus / (1.0 + tan_minus * tan_minus) * deg, dtan_plus / (1.0 + tan_plus * tan_plus) * deg, depsilon * deg};
+        }
+
+        // stapp: S = 2 (1 - iR)^-1 - 1 and dS = 2i (1 - iR)^-1 dR (1 - iR)^-1.
+        using cd = std::complex<double>;
+        const cd i1(0.0, 1.0);
+        cd m11 = 1.0 - i1 * r11, m12 = -i1 * r12, m22 = 1.0 - i1 * r22;
+        cd det = m11 * m22 - m12 * m12;
+        cd inv11 = m22 / det, inv12 = -m12 / det, inv22 = m11 / det;
+        cd s11 = 2.0 * inv11 - 1.0, s12 = 2.0 * inv12, s22 = 2.0 * inv22 - 1.0;
+        cd x11 = dr11 * inv11 + dr12 * inv12, x12 = dr11 * inv12 + dr12 * inv22;
+        cd x21 = dr12 * inv11 + dr22 * inv12, x22 = dr12 * inv12 + dr22 * inv22;
+        cd ds11 = 2.0 * i1 * (inv11 * x11 + inv12 * x21);
+        cd ds12 = 2.0 * i1 * (inv11 * x12 + inv12 * x22);
+        cd ds22 = 2.0 * i1 * (inv12 * x12 + inv22 * x22);
+        double delta_minus = 0.5 * std::arg(s11), delta_plus = 0.5 * std::arg(s22);
+        double ddelta_minus = 0.5 * std::imag(ds11 / s11), ddelta_plus = 0.5 * std::imag(ds22 / s22);
+        cd phase = std::exp(-i1 * (delta_minus + delta_plus));
+        double sin_2epsilon = std::clamp(std::real(-i1 * s12 * phase), -1.0, 1.0);
+        double dsin_2epsilon = std::real(-i1 * phase * (ds12 - i1 * s12 * (ddelta_minus + ddelta_plus)));
+        double depsilon = 0.5 * dsin_2epsilon / std::sqrt(1.0 - sin_2epsilon * sin_2epsilon);
+        return {ddelta_minus * deg, ddelta_plus * deg, depsilon * deg};
+    }
+
+    // continue the phase shifts of one channel in energy, down from the highest tlab where they are in (-90, 90]:
+    // a jump of more than 90 degrees is a change of branch, e.g. the 3S1 phase starting at 180 degrees. a stapp
+    // phase shift shifted by 180 degrees flips the sign of epsilon, the blatt mixing angle is unchanged. the derivatives
+    // from "derivative_first" on, [parameter][delta(l=j-1), delta(l=j+1), epsilon] per energy, follow epsilon.
+    void continue_in_energy(std::vector<std::vector<double>>::iterator first, std::vector<std::vector<double>>::iterator last, const std::string &convention,
+                            std::vector<std::vector<double>>::iterator derivative_first)
+    {
+        for (auto it = last - 1; it != first; it = it - 1)
+        {
+            auto &lower = *(it - 1);
+            for (size_t idx = 0; idx < std::min<size_t>(lower.size(), 2); idx = idx + 1)
+            {
+                double jump = lower[idx] - (*it)[idx];
+                if (std::abs(jump) > 90.0)
+                {
+                    lower[idx] -= std::copysign(180.0, jump);
+                    if (lower.size() == 3 && convention == "stapp")
+                    {
+                        lower[2] = -lower[2];
+                        auto &lower_derivatives = *(derivative_first + (it - 1 - first));
+                        for (size_t idx_epsilon = 2; idx_epsilon < lower_derivatives.size(); idx_epsilon = idx_epsilon + 3)
+                        {
+                            lower_derivatives[idx_epsilon] = -lower_derivatives[idx_epsilon];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // write the phases "results" of all groups and energies with the title "title", taking the phases of the
+    // parameter "idx_parameter" of every entry.
+    void write_table(const std::string &fname, const std::string &title, const std::vector<channel_group> &groups, const std::vector<double> &tlabs,
+                     const std::vector<std::vector<double>> &results, size_t idx_parameter, const NN::NN_configs &configs, const settings &st)
+    {
+        size_t energies = tlabs.size();
+        std::ofstream fp(fname);
+        fp << "# " << title << ", " << st.convention << " convention, " << configs.mesh_points_number << " mesh points\n"
+           << "# uncoupled channels l'-l-s-j-tz: tlab[MeV] q[MeV] delta\n"
+           << "# coupled channels coupled-j-tz: tlab[MeV] q[MeV] delta(l=j-1) delta(l=j+1) epsilon\n";
+        fp << std::scientific << std::setprecision(10);
+        for (size_t g = 0; g < groups.size(); g = g + 1)
+        {
+            const auto &c = groups[g].channels[0];
+            size_t phase_number = groups[g].channels.size() == 4 ? 3 : 1;
+            fp << "\n# " << (phase_number == 3 ? kernel_output::coupled_tag(c) : kernel_output::channel_tag(c)) << "\n";
+            for (size_t e = 0; e < energies; e = e + 1)
+            {
+                const auto &values = results[g * energies + e];
+                fp << std::setw(18) << tlabs[e] << std::setw(18) << configs.get_rel_mom(tlabs[e], c[4]);
+                for (size_t idx = idx_parameter * phase_number; idx < (idx_parameter + 1) * phase_number; idx = idx + 1)
+                {
+                    fp << std::setw(18) << values[idx];
+                }
+                fp << "\n";
+            }
+        }
+    }
+
+    // phase shifts of all channels of the tables at all energies, written to result_name-phase-shifts.txt, and their
+    // derivatives with respect to configs.derivatives to result_name-d<parameter>-phase-shifts.txt.
+    void run(const inifile_system::inifile &ini, const NN::NN_configs &configs)
+    {
+        auto st = read_settings(ini);
+        // the extra row and column are evaluated with the fixed angular rule and without screening, the mesh kernels
+        // must be the same so that one system holds one quadrature.
+        if (configs.angular_mode != "fixed" || configs.screening)
+        {
+            std::cerr << "phase shifts need angular_mode = fixed and screening = false" << std::endl;
+            exit(-1);
+        }
+        auto tlabs = read_tlabs(st.tlab_file);
+        double p_max = std::accumulate(configs.momentum_mesh_weights.begin(), configs.momentum_mesh_weights.end(), 0.0);
+        for (double tlab : tlabs)
+        {
+            for (int tz = -1; tz <= 1; tz = tz + 1)
+            {
+                if (configs.get_rel_mom(tlab, tz) >= p_max)
+                {
+                    std::cerr << "tlab = " << tlab << " MeV is beyond the momentum mesh, p_max = " << p_max << " MeV" << std::endl;
+                    exit(-1);
+                }
+            }
+        }
+
+        // mesh kernels of every channel, with the angular integration parallel, and their derivatives.
+        auto start = std::chrono::steady_clock::now();
+        auto groups = make_groups(configs);
+        size_t parameters = configs.derivatives.size();
+        for (auto &group : groups)
+        {
+            group.kernel_derivatives.resize(parameters);
+            for (const auto &channel : group.channels)
+            {
+                if (parameters == 0)
+                {
+                    group.kernels.push_back(kernel_output::compute_channel(channel, configs));
+                    continue;
+                }
+                std::vector<std::vector<double>> derivatives;
+                group.kernels.push_back(kernel_output::compute_channel_derivatives(channel, configs, derivatives));
+                for (size_t idx_parameter = 0; idx_parameter < parameters; idx_parameter = idx_parameter + 1)
+                {
+                    group.kernel_derivatives[idx_parameter].push_back(std::move(derivatives[idx_parameter]));
+                }
+            }
+        }
+        auto kernels_end = std::chrono::steady_clock::now();
+
+        // one lippmann-schwinger solve per (channel, energy), the angular integrals inside are serial.
+        size_t energies = tlabs.size();
+        // the derivatives of a task are [parameter][phase].
+        std::vector<std::vector<double>> results(groups.size() * energies), derivative_results(groups.size() * energies);
+#pragma omp parallel for schedule(dynamic)
+        for (size_t task = 0; task < groups.size() * energies; task = task + 1)
+        {
+            const auto &group = groups[task / energies];
+            int tz = group.channels[0][4];
+            double q = configs.get_rel_mom(tlabs[task % energies], tz);
+            std::vector<std::vector<double>> k_derivatives;
+            auto k_matrix = on_shell_k_matrix(group, q, configs, k_derivatives);
+            results[task] = phases(k_matrix, q, twice_reduced_mass(tz, configs), st.convention);
+            for (const auto &dk_matrix : k_derivatives)
+            {
+                auto d = phase_derivatives(k_matrix, dk_matrix, q, twice_reduced_mass(tz, configs), st.convention);
+                derivative_results[task].insert(derivative_results[task].end(), d.begin(), d.end());
+            }
+        }
+        for (size_t g = 0; g < groups.size() && energies > 0; g = g + 1)
+        {
+            continue_in_energy(results.begin() + g * energies, results.begin() + (g + 1) * energies, st.convention, derivative_results.begin() + g * energies);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        std::string fname = configs.result_dir + configs.result_name + "-phase-shifts.txt";
+        write_table(fname, "phase shifts in degrees of " + configs.result_name, groups, tlabs, results, 0, configs, st);
+        for (size_t idx_parameter = 0; idx_parameter < parameters; idx_parameter = idx_parameter + 1)
+        {
+            std::string name = kernel_output::derivative_name(configs.result_name, configs.derivatives[idx_parameter]);
+            write_table(configs.result_dir + name + "-phase-shifts.txt", "derivatives of the phase shifts in degrees of " + configs.result_name + " with respect to " +
+                            dual_numbers::parameter_names[configs.derivatives[idx_parameter]],
+                        groups, tlabs, derivative_results, idx_parameter, configs, st);
+        }
+
+        std::cout.precision(4);
+        std::cout << "---- phase shifts of " << groups.size() << " channels at " << energies << " energies written in: " << fname << "\n"
+                  << "     mesh kernels: " << std::chrono::duration<double>(kernels_end - start).count() << " s, lippmann-schwinger: "
+                  << std::chrono::duration<double>(end - kernels_end).count() << " s" << std::endl;
+    }
+
+} // namespace phase_shifts
+
+#endif // PHASE_SHIFTS_HPP
@@ -0,0 +1,471 @@
+#pragma once
+#ifndef PLANNER_HPP
+#define PLANNER_HPP
+
+#include "kernel_output.hpp"
+#include "lib_define.hpp"
+#include <filesystem>
+#include <map>
+#include <numeric>
+#include <set>
+#include <unistd.h>
+
+// dry run "NN-cms.x --plan": validate the channels of the tables and predict the cost of the run from a few
+// timed matrix elements per channel, without writing kernels. the cost model of one channel at t threads is
+//     n^2 * (t_angle * ceil(E / t) + t_fork(t) + t_io) + t_plan,
+// with t_angle the single-thread time of one angular integrand evaluation, E the evaluations per element
+// (angular_mesh_number, or the mean of the adaptive plan), t_fork the measured cost of one parallel region
+// with t threads, t_io the serial text formatting and packing per element and t_plan the adaptive probes.
+// with tiled_output the threads work on whole elements instead: n^2 * (t_angle * E + t_io) / t + t_plan.
+// channels are then distributed over processes (shards) by longest processing time first.
+namespace planner
+{
+    struct settings
+    {
+        size_t cores;           // cores of a node, default: all cores of this machine.
+        double memory_bytes;    // memory of a node, default: physical memory of this machine.
+        double max_shard_hours; // wall time limit of one job.
+        size_t samples;         // timed elements per channel.
+        std::string shard_dir;  // write the tables of every shard below this directory (optional).
+    };
+
+    struct channel_estimate
+    {
+        std::vector<int> channel;
+        std::string status;               // empty, or a warning or the reason the channel cannot be computed.
+        bool fatal = false;               // the run would fail or write a wrong kernel.
+        double angle_seconds = 0.0;       // t_angle.
+        double evaluations = 0.0;         // E, angular evaluations per element.
+        double plan_evaluations = 0.0;    // adaptive probes of the channel.
+        double txt_bytes = 0.0;
+        double bin_bytes = 0.0;
+        bool tiled = false;               // tiled_output: threads on tiles of elements, formatting in parallel.
+
+        // wall seconds at "threads" threads with "fork_seconds" per parallel region and "io_seconds" per element.
+        double seconds(size_t n, size_t threads, double fork_seconds, double io_seconds) const
+        {
+            double element = angle_seconds * std::ceil(evaluations / threads) + fork_seconds + io_seconds;
+            if (tiled)
+            {
+                element = (angle_seconds * evaluations + io_seconds) / threads;
+            }
+            return double(n * n) * element + plan_evaluations * angle_seconds;
+        }
+    };
+
+    // one line of the channel tables: an uncoupled channel, or the four channels of a coupled (j, tz).
+    struct table_line
+    {
+        bool coupled;
+        std::vector<size_t> channels; // indices into configs.partial_waves.
+    };
+
+    settings read_settings(const inifile_system::inifile &ini)
+    {
+        settings st;
+        st.cores = omp_get_num_procs();
+        st.memory_bytes = double(sysconf(_SC_PHYS_PAGES)) * double(sysconf(_SC_PAGE_SIZE));
+        st.max_shard_hours = 24.0;
+        st.samples = 16;
+        st.shard_dir = "";
+        if (!ini.has_section("plan"))
+        {
+            return st;
+        }
+        auto sec = ini.section("plan");
+        st.cores = sec.has_key("cores") ? sec.get_int("cores") : st.cores;
+        st.memory_bytes = sec.has_key("memory_gb") ? sec.get_double("memory_gb") * 1e9 : st.memory_bytes;
+        st.max_shard_hours = sec.has_key("max_shard_hours") ? sec.get_double("max_shard_hours") : st.max_shard_hours;
+        st.samples = sec.has_key("samples") ? sec.get_int("samples") : st.samples;
+        st.shard_dir = sec.has_key("shard_dir") ? sec.get_string("shard_dir") : st.shard_dir;
+        if (st.cores == 0 || st.samples == 0 || st.max_shard_hours <= 0.0)
+        {
+            std::cerr << "[plan] needs cores > 0, samples > 0 and max_shard_hours > 0" << std::endl;
+            exit(-1);
+        }
+        return st;
+    }
+
+    // problems of one channel, empty if it can be computed.
+    std::string check_channel(const std::vector<int> &channel, bool &fatal)
+    {
+        int l_final = channel[0], l_initial = channel[1], s = channel[2], j = channel[3], tz = channel[4];
+        fatal = true;
+        if (tz < -1 || tz > 1)
+        {
+            return "tz must be -1, 0 or 1";
+        }
+        if (j > interaction_aPWD::j_max)
+        {
+            return "J > " + std::to_string(interaction_aPWD::j_max) + " not supported by potential_auto";
+        }
+        if (!interaction_aPWD::supported(l_final, l_initial, s, j))
+        {
+            return "no such partial wave (l', l, s, J)";
+        }
+        fatal = false;
+        if (tz != 0 && (l_final + s) % 2 != 0)
+        {
+            return "Pauli forbidden for pp and nn (l + s odd)";
+        }
+        return "";
+    }
+
+    // group the channels into the lines of the tables they were read from.
+    std::vector<table_line> table_lines(const std::vector<std::vector<int>> &channels)
+    {
+        std::vector<table_line> lines;
+        for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+        {
+            if (kernel_output::coupled_group(channels, idx))
+            {
+                lines.push_back({true, {idx, idx + 1, idx + 2, idx + 3}});
+                idx = idx + 3;
+            }
+            else
+            {
+                lines.push_back({false, {idx}});
+            }
+        }
+        return lines;
+    }
+
+    // single-thread seconds per angular evaluation of one channel, from "samples" elements spread over the mesh.
+    double time_angle(const std::vector<int> &channel, const NN::NN_configs &configs, size_t samples)
+    {
+        size_t n = configs.mesh_points_number;
+        double best = 1e300;
+        for (int repeat = 0; repeat < 2; repeat = repeat + 1)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t k = 0; k < samples; k = k + 1)
+            {
+                size_t idx_bra = (k * 7 + 1) % n;
+                size_t idx_ket = (k * 13 + 5) % n;
+                interaction_all::potential_element(channel[0], channel[1], channel[2], channel[3], channel[4], configs.momentum_mesh_points[idx_bra],
+                                                   configs.momentum_mesh_points[idx_ket], configs);
+            }
+            auto end = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+        return best / double(samples * configs.angular_mesh_number);
+    }
+
+    // seconds of one parallel region over "iterations" trivial iterations with "threads" threads.
+    double time_fork(size_t threads, size_t iterations)
+    {
+        const int repeats = 200;
+        std::vector<double> sink(iterations, 0.0);
+        auto start = std::chrono::steady_clock::now();
+        for (int repeat = 0; repeat < repeats; repeat = repeat + 1)
+        {
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+            for (size_t i = 0; i < iterations; i = i + 1)
+            {
+                sink[i] += 1.0;
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(end - start).count() / repeats;
+    }
+
+    // seconds per element of writing the text file and packing it, serial.
+    double time_io(size_t values)
+    {
+        std::ostringstream oss;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < values; i = i + 1)
+        {
+            oss << std::fixed << " " << std::scientific << std::setprecision(17) << -0.123456789 * double(i + 1);
+        }
+        std::istringstream iss(oss.str());
+        double value;
+        while (iss >> value)
+        {
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(end - start).count() / double(values);
+    }
+
+    // longest processing time first: the line indices of every shard, returns the longest shard in seconds.
+    double distribute(const std::vector<table_line> &lines, const std::vector<double> &line_seconds, size_t shards, std::vector<std::vector<size_t>> &assignment)
+    {
+        std::vector<size_t> order(lines.size());
+        for (size_t idx = 0; idx < order.size(); idx = idx + 1)
+        {
+            order[idx] = idx;
+        }
+        std::stable_sort(order.begin(), order.end(), [&line_seconds](size_t a, size_t b)
+                         { return line_seconds[a] > line_seconds[b]; });
+        assignment.assign(shards, {});
+        std::vector<double> load(shards, 0.0);
+        for (auto idx : order)
+        {
+            size_t lightest = std::min_element(load.begin(), load.end()) - load.begin();
+            assignment[lightest].push_back(idx);
+            load[lightest] += line_seconds[idx];
+        }
+        return *std::max_element(load.begin(), load.end());
+    }
+
+    // write the channel tables of every shard to shard_dir/shard-<k>/.
+    void write_shard_tables(const std::string &shard_dir, const std::vector<std::vector<size_t>> &assignment, const std::vector<table_line> &lines,
+                            const std::vector<std::vector<int>> &channels)
+    {
+        for (size_t k = 0; k < assignment.size(); k = k + 1)
+        {
+            std::string dir = shard_dir + "/shard-" + std::to_string(k);
+            std::filesystem::create_directories(dir);
+            std::ofstream fp_uncoupled(dir + "/table_uncoupled_channels.txt");
+            std::ofstream fp_coupled(dir + "/table_coupled_channels.txt");
+            fp_uncoupled << "# uncoupled partial-waves: l s j tz; (l'=l)\n";
+            fp_coupled << "# coupled partial-waves: j tz; (s=1; l,l'=j+-1)\n";
+            for (auto idx : assignment[k])
+            {
+                const auto &c = channels[lines[idx].channels[0]];
+                if (lines[idx].coupled)
+                {
+                    fp_coupled << c[3] << " " << c[4] << "\n";
+                }
+                else
+                {
+                    fp_uncoupled << c[0] << " " << c[2] << " " << c[3] << " " << c[4] << "\n";
+                }
+            }
+        }
+    }
+
+    std::string format_seconds(double seconds)
+    {
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(2);
+        if (seconds < 120.0)
+        {
+            oss << seconds << " s";
+        }
+        else if (seconds < 7200.0)
+        {
+            oss << seconds / 60.0 << " min";
+        }
+        else
+        {
+            oss << seconds / 3600.0 << " h";
+        }
+        return oss.str();
+    }
+
+    std::string format_bytes(double bytes)
+    {
+        const char *units[] = {"B", "kB", "MB", "GB", "TB"};
+        int unit = 0;
+        while (bytes >= 1000.0 && unit < 4)
+        {
+            bytes /= 1000.0;
+            unit = unit + 1;
+        }
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << bytes << " " << units[unit];
+        return oss.str();
+    }
+
+    // validate and estimate the run of "ini", returns the number of channels that cannot be computed.
+    size_t run(const inifile_system::inifile &ini)
+    {
+        auto st = read_settings(ini);
+        auto setup_start = std::chrono::steady_clock::now();
+        NN::NN_configs configs(ini);
+        double setup_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - setup_start).count();
+        double base_bytes = profiler::peak_rss_bytes();
+
+        size_t n = configs.mesh_points_number;
+        const auto &channels = configs.partial_waves;
+        bool adaptive = (configs.angular_mode == "adaptive");
+        std::cout << "---- plan: " << channels.size() << " channels, " << n << " x " << n << " elements, " << configs.chiral_order << ", precision " << configs.precision
+                  << ", angular " << configs.angular_mode << " (" << configs.angular_mesh_number << " points)\n"
+                  << "     node: " << st.cores << " cores, " << format_bytes(st.memory_bytes) << ", shard limit " << st.max_shard_hours << " h\n\n";
+
+        // calibration, single-threaded.
+        omp_set_num_threads(1);
+        double io_seconds = time_io(4096);
+        std::vector<channel_estimate> estimates(channels.size());
+        std::set<std::vector<int>> seen;
+        size_t fatal_number = 0;
+        for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+        {
+            auto &est = estimates[idx];
+            est.channel = channels[idx];
+            est.status = check_channel(est.channel, est.fatal);
+            if (est.status.empty() && !seen.insert(est.channel).second)
+            {
+                est.status = "duplicate, written twice";
+            }
+            if (est.fatal)
+            {
+                fatal_number = fatal_number + 1;
+                continue;
+            }
+            est.angle_seconds = time_angle(est.channel, configs, st.samples);
+            est.evaluations = configs.angular_mesh_number;
+            if (adaptive)
+            {
+                auto pl = angular_quadrature::make_plan(est.channel, configs);
+                est.evaluations = double(pl.element_evaluations) / double(n * n);
+                est.plan_evaluations = pl.probe_evaluations;
+            }
+            est.bin_bytes = double(n * n) * (configs.binary_precision == "float" ? 4.0 : 8.0);
+            est.txt_bytes = double(n) * (double(n) * 25.0 + 1.0); // " -d.<17 digits>e+XX" per value, upper bound.
+            est.tiled = configs.tiled_output;
+            if (est.tiled)
+            {
+                est.txt_bytes = double(n) * (double(n) * kernel_output::tiled_txt_width + 1.0);
+            }
+        }
+
+        // parallel regions per element, one per angular integral.
+        std::vector<size_t> candidates;
+        for (size_t t = 1; t <= st.cores; t = t * 2)
+        {
+            candidates.push_back(t);
+        }
+        if (candidates.back() != st.cores)
+        {
+            candidates.push_back(st.cores);
+        }
+        size_t mean_evaluations = adaptive ? configs.angular_orders[configs.angular_orders.size() / 2] : configs.angular_mesh_number;
+        std::map<size_t, double> fork_seconds;
+        for (auto t : candidates)
+        {
+            fork_seconds[t] = time_fork(t, mean_evaluations);
+        }
+        omp_set_num_threads(configs.thread_number);
+
+        // per-channel table at the configured thread number.
+        double single_thread_seconds = setup_seconds;
+        double txt_total = 0.0, bin_total = 0.0;
+        double configured_fork = time_fork(configs.thread_number, mean_evaluations);
+        size_t configured_threads = configs.tiled_output ? std::min(configs.thread_number, st.cores) : configs.thread_number;
+        std::cout << std::left << std::setw(16) << "channel" << std::right << std::setw(12) << "core-s" << std::setw(12) << "wall-s" << std::setw(12) << "txt"
+                  << std::setw(12) << "bin" << "   status\n";
+        for (const auto &est : estimates)
+        {
+            std::cout << std::left << std::setw(16) << kernel_output::channel_tag(est.channel) << std::right;
+            if (est.fatal)
+            {
+                std::cout << std::setw(48) << "" << "   ERROR: " << est.status << "\n";
+                continue;
+            }
+            double core_s = est.seconds(n, 1, fork_seconds[1], io_seconds);
+            double wall_s = est.seconds(n, configured_threads, configured_fork, io_seconds);
+            single_thread_seconds += core_s;
+            txt_total += est.txt_bytes;
+            bin_total += est.bin_bytes;
+            std::cout << std::fixed << std::setprecision(2) << std::setw(12) << core_s << std::setw(12) << wall_s << std::setw(12) << format_bytes(est.txt_bytes)
+                      << std::setw(12) << format_bytes(est.bin_bytes) << "   " << (est.status.empty() ? "ok" : "warning: " + est.status) << "\n";
+        }
+        double other_bytes = double(n) * 48.0 + double(channels.size()) * 16.0 + 128.0; // momentum mesh and partial-waves files.
+        double output_total = txt_total + bin_total + other_bytes;
+
+        // peak memory of one process: setup, one channel matrix, and with shm_name all kernels plus the segment.
+        double kernel_bytes = double(n * n) * 8.0;
+        double peak_bytes = base_bytes + kernel_bytes;
+        if (configs.tiled_output)
+        {
+            double value_bytes = configs.binary_precision == "float" ? 4.0 : 8.0;
+            peak_bytes = base_bytes + std::min(configs.memory_budget_mb * 1e6, double(n) * (double(n) * (8.0 + kernel_output::tiled_txt_width + value_bytes) + 1.0));
+        }
+        if (!configs.shm_name.empty())
+        {
+            peak_bytes += 2.0 * kernel_bytes * double(channels.size());
+        }
+
+        double configured_seconds = std::accumulate(estimates.begin(), estimates.end(), setup_seconds, [&](double sum, const channel_estimate &est)
+                                                    { return est.fatal ? sum : sum + est.seconds(n, configured_threads, configured_fork, io_seconds); });
+        std::cout << "\n---- totals\n"
+                  << "     setup (configs, tables):  " << format_seconds(setup_seconds) << "\n"
+                  << "     single-thread cost:       " << format_seconds(single_thread_seconds) << " (" << std::scientific << std::setprecision(2)
+                  << single_thread_seconds / 3600.0 << " core-hours)\n"
+                  << "     wall at threads = " << configs.thread_number << ":    " << format_seconds(configured_seconds) << " (" << configured_seconds * configs.thread_number / 3600.0
+                  << " core-hours)\n"
+                  << "     peak memory per process:  " << format_bytes(peak_bytes) << "\n"
+                  << "     output:                   " << format_bytes(output_total) << " (txt " << format_bytes(txt_total) << ", bin " << format_bytes(bin_total) << ")\n";
+        if (std::filesystem::exists(configs.result_dir))
+        {
+            auto space = std::filesystem::space(configs.result_dir);
+            std::cout << "     free in " << configs.result_dir << ": " << format_bytes(double(space.available)) << (double(space.available) < output_total ? "   NOT ENOUGH" : "") << "\n";
+        }
+        else
+        {
+            std::cout << "     result_dir does not exist: " << configs.result_dir << "\n";
+        }
+
+        // recommendation: the thread number and shard count with the shortest longest shard that fit the node.
+        auto lines = table_lines(channels);
+        lines.erase(std::remove_if(lines.begin(), lines.end(), [&estimates](const table_line &line)
+                                   { return std::any_of(line.channels.begin(), line.channels.end(), [&estimates](size_t c)
+                                                        { return estimates[c].fatal; }); }),
+                    lines.end());
+        size_t best_threads = 1, best_shards = 1;
+        double best_makespan = 1e300;
+        std::vector<std::vector<size_t>> best_assignment;
+        for (auto t : candidates)
+        {
+            std::vector<double> line_seconds(lines.size(), 0.0);
+            for (size_t idx = 0; idx < lines.size(); idx = idx + 1)
+            {
+                for (auto c : lines[idx].channels)
+                {
+                    line_seconds[idx] += estimates[c].seconds(n, t, fork_seconds[t], io_seconds);
+                }
+            }
+            size_t shards = std::max<size_t>(1, std::min(lines.size(), st.cores / t));
+            while (shards > 1 && double(shards) * peak_bytes > st.memory_bytes)
+            {
+                shards = shards - 1;
+            }
+            std::vector<std::vector<size_t>> assignment;
+            double makespan = setup_seconds + distribute(lines, line_seconds, shards, assignment);
+            if (makespan < 0.95 * best_makespan)
+            {
+                best_makespan = makespan;
+                best_threads = t;
+                best_shards = shards;
+                best_assignment = assignment;
+            }
+        }
+        std::cout << "\n---- recommendation\n"
+                  << "     threads = " << best_threads << " per process, " << best_shards << " shard(s) side by side on one node\n"
+                  << "     longest shard: " << format_seconds(best_makespan) << ", charged: " << std::scientific << std::setprecision(2)
+                  << best_makespan * double(best_threads * best_shards) / 3600.0 << " core-hours\n";
+        if (best_makespan / 3600.0 > st.max_shard_hours)
+        {
+            std::cout << "     the longest shard exceeds max_shard_hours, use about " << size_t(std::ceil(best_makespan / 3600.0 / st.max_shard_hours))
+                      << " nodes or a coarser mesh\n";
+        }
+        if (best_shards > 1)
+        {
+            for (size_t k = 0; k < best_assignment.size(); k = k + 1)
+            {
+                std::cout << "     shard " << k << ":";
+                for (auto idx : best_assignment[k])
+                {
+                    std::cout << " " << kernel_output::channel_tag(channels[lines[idx].channels[0]]) << (lines[idx].coupled ? "(+3)" : "");
+                }
+                std::cout << "\n";
+            }
+            if (!st.shard_dir.empty())
+            {
+                write_shard_tables(st.shard_dir, best_assignment, lines, channels);
+                std::cout << "     channel tables of the shards written in: " << st.shard_dir << "/shard-<k>/\n";
+            }
+        }
+        if (fatal_number > 0)
+        {
+            std::cout << "\n---- " << fatal_number << " channel(s) cannot be computed, fix the tables before submitting\n";
+        }
+        std::cout << std::endl;
+        return fatal_number;
+    }
+
+} // namespace planner
+
+#endif // PLANNER_HPP
@@ -0,0 +1,236 @@
+#pragma once
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+#include <omp.h>
+
+// opt-in per-stage timing, switched on by "run_report = true" in the [output] section.
+// time and call counts are accumulated per thread and per channel without any locking,
+// when it is off every timer costs a single branch.
+namespace profiler
+{
+    enum stage
+    {
+        contact_lo,
+        contact_nlo,
+        one_pion_exchange,
+        two_pion_exchange_nlo,
+        two_pion_exchange_n2lo,
+        two_pion_exchange_n3lo,
+        loop_functions,
+        apwd_projection,
+        matrix_element,
+        text_formatting,
+        binary_packing,
+        stage_number
+    };
+
+    const std::array<const char *, stage_number> stage_names = {"contact_lo", "contact_nlo", "one_pion_exchange", "two_pion_exchange_nlo", "two_pion_exchange_n2lo",
+                                                                "two_pion_exchange_n3lo", "loop_functions", "apwd_projection", "matrix_element", "text_formatting", "binary_packing"};
+
+    struct counter
+    {
+        double seconds = 0.0;
+        size_t calls = 0;
+    };
+
+    // one slot per thread, padded so that threads never share a cache line.
+    struct alignas(64) thread_slot
+    {
+        std::vector<std::array<counter, stage_number>> channels;
+    };
+
+    bool enabled = false;
+    std::atomic<int> current_channel{0};
+    std::vector<thread_slot> slots;
+    std::vector<std::string> channel_names;
+
+    // prepare the accumulators for "names.size()" channels and the current openmp thread limit.
+    void start(const std::vector<std::string> &names)
+    {
+        enabled = true;
+        channel_names = names;
+        slots.assign(omp_get_max_threads(), thread_slot());
+        for (auto &slot : slots)
+        {
+            slot.channels.assign(names.size(), std::array<counter, stage_number>());
+        }
+    }
+
+    void set_channel(int idx_channel) { current_channel.store(idx_channel, std::memory_order_relaxed); }
+
+    // thread of the innermost active parallel region. inside an inactive nested region, e.g. the angular sums of a
+    // tile of the tiled output, omp_get_thread_num() is 0 on every thread of the active one.
+    size_t active_thread()
+    {
+        for (int level = omp_get_level(); level > 0; level = level - 1)
+        {
+            if (omp_get_team_size(level) > 1)
+            {
+                return omp_get_ancestor_thread_num(level);
+            }
+        }
+        return 0;
+    }
+
+    void add(stage st, double seconds)
+    {
+        size_t thread = active_thread();
+        int ch = current_channel.load(std::memory_order_relaxed);
+        if (thread >= slots.size() || ch < 0 || static_cast<size_t>(ch) >= channel_names.size())
+        {
+            return;
+        }
+        auto &c = slots[thread].channels[ch][st];
+        c.seconds += seconds;
+        c.calls += 1;
+    }
+
+    // RAII timer: accumulates the time between construction and destruction into a stage.
+    class scoped_timer
+    {
+    public:
+        scoped_timer(stage st) : st(st), active(enabled)
+        {
+            if (active)
+            {
+                t0 = std::chrono::steady_clock::now();
+            }
+        }
+        ~scoped_timer()
+        {
+            if (active)
+            {
+                add(st, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+            }
+        }
+
+    private:
+        stage st;
+        bool active;
+        std::chrono::steady_clock::time_point t0;
+    };
+
+    // peak resident set size in bytes.
+    size_t peak_rss_bytes()
+    {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+    }
+
+    // write the JSON run report. stages are inclusive: loop_functions is part of the
+    // two-pion-exchange stages, and every stage evaluated per element is part of matrix_element.
+    void write_report(const std::string &fname, double wall_seconds, size_t threads, size_t mesh_points_number, size_t angular_mesh_number)
+    {
+        std::ofstream fp(fname);
+        if (!fp.is_open())
+        {
+            std::cerr << "failed to open run report: " << fname << std::endl;
+            return;
+        }
+
+        std::array<counter, stage_number> total;
+        std::vector<std::array<counter, stage_number>> per_channel(channel_names.size());
+        std::vector<double> thread_busy(slots.size(), 0.0);
+        for (size_t t = 0; t < slots.size(); t = t + 1)
+        {
+            for (size_t ch = 0; ch < channel_names.size(); ch = ch + 1)
+            {
+                for (size_t st = 0; st < stage_number; st = st + 1)
+                {
+                    const auto &c = slots[t].channels[ch][st];
+                    total[st].seconds += c.seconds;
+                    total[st].calls += c.calls;
+                    per_channel[ch][st].seconds += c.seconds;
+                    per_channel[ch][st].calls += c.calls;
+                }
+                // busy time of a thread: the stages that are not nested in another one.
+                for (auto st : {contact_lo, contact_nlo, one_pion_exchange, two_pion_exchange_nlo, two_pion_exchange_n2lo, two_pion_exchange_n3lo, apwd_projection, text_formatting, binary_packing})
+                {
+                    thread_busy[t] += slots[t].channels[ch][st].seconds;
+                }
+            }
+        }
+        double busy_max = 0.0;
+        double busy_sum = 0.0;
+        for (auto b : thread_busy)
+        {
+            busy_max = std::max(busy_max, b);
+            busy_sum += b;
+        }
+        double busy_mean = busy_sum / thread_busy.size();
+        size_t elements = total[matrix_element].calls;
+
+        auto write_stages = [&fp](const std::array<counter, stage_number> &counters, const std::string &indent)
+        {
+            for (size_t st = 0; st < stage_number; st = st + 1)
+            {
+                fp << indent << "\"" << stage_names[st] << "\": {\"seconds\": " << counters[st].seconds << ", \"calls\": " << counters[st].calls << "}"
+                   << (st + 1 < stage_number ? "," : "") << "\n";
+            }
+        };
+
+        fp << std::setprecision(9);
+        fp << "{\n";
+        fp << "  \"wall_seconds\": " << wall_seconds << ",\n";
+        fp << "  \"threads\": " << threads << ",\n";
+        fp << "  \"mesh_points_number\": " << mesh_points_number << ",\n";
+        fp << "  \"angular_mesh_number\": " << angular_mesh_number << ",\n";
+        fp << "  \"matrix_elements\": " << elements << ",\n";
+        fp << "  \"matrix_elements_per_second\": " << (wall_seconds > 0.0 ? elements / wall_seconds : 0.0) << ",\n";
+        fp << "  \"peak_rss_bytes\": " << peak_rss_bytes() << ",\n";
+        fp << "  \"thread_load_imbalance\": " << (busy_mean > 0.0 ? busy_max / busy_mean : 1.0) << ",\n";
+        fp << "  \"thread_busy_seconds\": [";
+        for (size_t t = 0; t < thread_busy.size(); t = t + 1)
+        {
+            fp << thread_busy[t] << (t + 1 < thread_busy.size() ? ", " : "");
+        }
+        fp << "],\n";
+        fp << "  \"stages\": {\n";
+        write_stages(total, "    ");
+        fp << "  },\n";
+        fp << "  \"thread_stages\": [\n";
+        for (size_t t = 0; t < slots.size(); t = t + 1)
+        {
+            std::array<counter, stage_number> per_thread;
+            for (const auto &counters : slots[t].channels)
+            {
+                for (size_t st = 0; st < stage_number; st = st + 1)
+                {
+                    per_thread[st].seconds += counters[st].seconds;
+                    per_thread[st].calls += counters[st].calls;
+                }
+            }
+            fp << "    {\n";
+            write_stages(per_thread, "      ");
+            fp << "    }" << (t + 1 < slots.size() ? "," : "") << "\n";
+        }
+        fp << "  ],\n";
+        fp << "  \"channels\": [\n";
+        for (size_t ch = 0; ch < channel_names.size(); ch = ch + 1)
+        {
+            fp << "    {\n";
+            fp << "      \"channel\": \"" << channel_names[ch] << "\",\n";
+            fp << "      \"stages\": {\n";
+            write_stages(per_channel[ch], "        ");
+            fp << "      }\n";
+            fp << "    }" << (ch + 1 < channel_names.size() ? "," : "") << "\n";
+        }
+        fp << "  ]\n";
+        fp << "}\n";
+        fp.close();
+    }
+
+} // namespace profiler
+
+#endif // PROFILER_HPP
@@ -0,0 +1,439 @@
+#pragma once
+#ifndef REMESH_HPP
+#define REMESH_HPP
+
+#include "kernel_output.hpp"
+#include "linear_algebra.hpp"
+#include "lib_define.hpp"
+
+// "NN-cms.x --remesh": the kernels of an existing run, read from "source_dir" with "source_name", interpolated onto
+// the momentum mesh of configs and written like a normal run. in p' and p, the kernels are interpolated with the
+// barycentric lagrange interpolant of degree d on the d + 1 source points x_k nearest the target,
+//     r(p) = sum_k lambda_k V_k / (p - x_k) / sum_k lambda_k / (p - x_k),
+// which converges like h^(d+1) with a small lebesgue constant on the clustered gauss-legendre meshes, where a global
+// interpolant (floater-hormann) is ill-conditioned by orders of magnitude. with the interpolation matrix R of the
+// target points, a channel is R V R^T, two matrix products. the error is estimated from holdout points: every
+// "holdout_stride"-th source point is left out, the kernel at the holdout pairs is interpolated from the other points,
+// and a block of "block" x "block" target points takes the largest holdout error around it. blocks whose estimate
+// exceeds "tolerance" times the peak of the channel, and targets outside the source mesh, are evaluated exactly.
+namespace remesh
+{
+    struct settings
+    {
+        std::string source_dir;
+        std::string source_name;
+        size_t order;          // degree d.
+        size_t holdout_stride; // every holdout_stride-th source point is a holdout point.
+        double tolerance;      // relative to the peak of the channel.
+        size_t block;          // target points per block and direction.
+    };
+
+    // [remesh] section, "source_dir" is required.
+    settings read_settings(const inifile_system::inifile &ini, const NN::NN_configs &configs)
+    {
+        if (!ini.has_section("remesh") || !ini.section("remesh").has_key("source_dir"))
+        {
+            std::cerr << "remeshing needs source_dir in [remesh]" << std::endl;
+            exit(-1);
+        }
+        auto sec = ini.section("remesh");
+        settings st;
+        st.source_dir = sec.get_string("source_dir");
+        st.source_name = sec.has_key("source_name") ? sec.get_string("source_name") : configs.result_name;
+        int64_t order = sec.has_key("order") ? sec.get_int("order") : 7;
+        int64_t stride = sec.has_key("holdout_stride") ? sec.get_int("holdout_stride") : 4;
+        int64_t block = sec.has_key("block") ? sec.get_int("block") : 8;
+        st.tolerance = sec.has_key("tolerance") ? sec.get_double("tolerance") : 1e-8;
+        if (order < 0 || stride < 2 || block < 1 || st.tolerance < 0.0)
+        {
+            std::cerr << "remeshing needs order >= 0, holdout_stride >= 2, block > 0 and tolerance >= 0" << std::endl;
+            exit(-1);
+        }
+        if (st.source_dir == configs.result_dir && st.source_name == configs.result_name)
+        {
+            std::cerr << "remeshing would overwrite its source: " << st.source_dir << st.source_name << std::endl;
+            exit(-1);
+        }
+        st.order = order;
+        st.holdout_stride = stride;
+        st.block = block;
+        return st;
+    }
+
+    // kernels of a finished run, row-major V(p', p) without weights.
+    struct source
+    {
+        std::vector<double> points;
+        std::vector<double> weights;
+        std::vector<std::vector<double>> kernels; // in the order of the channels of configs.
+    };
+
+    source read_source(const settings &st, const NN::NN_configs &configs)
+    {
+        source src;
+        std::string stem = st.source_dir + st.source_name;
+        std::ifstream fp_mesh(stem + "-momentum-mesh.txt");
+        if (!fp_mesh.is_open())
+        {
+            std::cerr << "failed to open the source mesh: " << stem << "-momentum-mesh.txt" << std::endl;
+            exit(-1);
+        }
+        std::string line;
+        while (std::getline(fp_mesh, line) && line[0] == '#')
+        {
+        }
+        size_t n = std::stoul(line);
+        double point, weight;
+        while (fp_mesh >> point >> weight)
+        {
+            src.points.push_back(point);
+            src.weights.push_back(weight);
+        }
+        if (src.points.size() != n || n < 2 || !std::is_sorted(src.points.begin(), src.points.end()))
+        {
+            std::cerr << "the source mesh needs at least two increasing points: " << stem << "-momentum-mesh.txt" << std::endl;
+            exit(-1);
+        }
+
+        // the source must have the interaction of configs, its values are mixed with exact ones.
+        auto layout = inifile_system::inifile(stem + "-kernel-layout.txt");
+        if (!layout.good() || !layout.has_section("interaction"))
+        {
+            std::cerr << "remeshing needs a source run that records its interaction in " << stem << "-kernel-layout.txt" << std::endl;
+            exit(-1);
+        }
+        // derived kernels, e.g. srg-evolved ones, cannot be completed with exact elements of the interaction.
+        const auto &sec_interaction = layout.section("interaction");
+        if (sec_interaction.has_key("derivation") && sec_interaction.get_string("derivation") != "none")
+        {
+            std::cerr << "remeshing needs kernels of the interaction itself, the source holds " << sec_interaction.get_string("derivation") << " kernels" << std::endl;
+            exit(-1);
+        }
+        for (const auto &[key, value] : kernel_output::interaction_record(configs))
+        {
+            std::string recorded = sec_interaction.has_key(key) ? sec_interaction.get_string(key) : "(none)";
+            if (recorded != value)
+            {
+                std::cerr << "the source run has another interaction: " << key << " is " << recorded << " there and " << value << " here" << std::endl;
+                exit(-1);
+            }
+        }
+
+        // the layout of the source files.
+        std::string matrix_order = "row", binary_precision = "double", compression = "none";
+        bool weight_folding = false;
+        if (layout.has_section("layout"))
+        {
+            auto sec = layout.section("layout");
+            if (sec.has_key("coupled_layout") && sec.get_string("coupled_layout") != "separate")
+            {
+                std::cerr << "remeshing needs source kernels with coupled_layout = separate" << std::endl;
+                exit(-1);
+            }
+            matrix_order = sec.has_key("matrix_order") ? sec.get_string("matrix_order") : matrix_order;
+            binary_precision = sec.has_key("binary_precision") ? sec.get_string("binary_precision") : binary_precision;
+            weight_folding = sec.has_key("weight_folding") ? sec.get_bool("weight_folding") : weight_folding;
+            compression = sec.has_key("compression") ? sec.get_string("compression") : compression;
+        }
+
+        bool single = (binary_precision == "float");
+        for (const auto &channel : configs.partial_waves)
+        {
+            std::string fname = st.source_dir + "kernel-" + st.source_name + "-" + kernel_output::channel_tag(channel);
+            std::vector<double> v(n * n);
+            if (compression == "lowrank")
+            {
+                // low-rank factors of the row-major matrix, whatever the matrix_order.
+                kernel_lowrank::factors f;
+                auto error = kernel_lowrank::read(fname + ".lowrank.bin", f);
+                if (!error.empty() || f.dim != n)
+                {
+                    std::cerr << (error.empty() ? "wrong dimension of the source kernel: " + fname + ".lowrank.bin" : error) << std::endl;
+                    exit(-1);
+                }
+                v = f.reconstruct();
+            }
+            else
+            {
+                fname += single ? ".f32.bin" : ".bin";
+                std::ifstream fp(fname, std::ios::binary);
+                if (single)
+                {
+                    std::vector<float> stored(n * n);
+                    fp.read(reinterpret_cast<char *>(stored.data()), n * n * sizeof(float));
+                    std::copy(stored.begin(), stored.end(), v.begin());
+                }
+                else
+                {
+                    fp.read(reinterpret_cast<char *>(v.data()), n * n * sizeof(double));
+                }
+                if (!fp)
+                {
+                    std::cerr << "failed to read the source kernel: " << fname << std::endl;
+                    exit(-1);
+                }
+            }
+            if (matrix_order == "column" && compression != "lowrank")
+            {
+                for (size_t i = 0; i < n; i = i + 1)
+                {
+                    for (size_t k = i + 1; k < n; k = k + 1)
+                    {
+                        std::swap(v[i * n + k], v[k * n + i]);
+                    }
+                }
+            }
+            if (weight_folding)
+            {
+                for (size_t i = 0; i < n; i = i + 1)
+                {
+                    for (size_t k = 0; k < n; k = k + 1)
+                    {
+                        v[i * n + k] /= src.points[i] * src.points[k] * std::sqrt(src.weights[i] * src.weights[k]);
+                    }
+                }
+            }
+            src.kernels.push_back(std::move(v));
+        }
+        return src;
+    }
+
+    // interpolation matrix (targets rows, nodes columns) of the barycentric lagrange interpolant on the "d" + 1 nodes
+    // nearest each target, with the weights lambda_k = 1 / prod_{j != k} (x_k - x_j) of the window. a target on a node
+    // takes the value of the node.
+    std::vector<double> interpolation_matrix(const std::vector<double> &x, size_t d, const std::vector<double> &targets)
+    {
+        size_t n = x.size();
+        d = std::min(d, n - 1);
+        std::vector<double> r(targets.size() * n, 0.0);
+        std::vector<double> lambda(d + 1);
+        for (size_t t = 0; t < targets.size(); t = t + 1)
+        {
+            double *row = r.data() + t * n;
+            auto node = std::lower_bound(x.begin(), x.end(), targets[t]);
+            if (node != x.end() && *node == targets[t])
+            {
+                row[node - x.begin()] = 1.0;
+                continue;
+            }
+            size_t above = node - x.begin();
+            size_t first = std::min(above > (d + 1) / 2 ? above - (d + 1) / 2 : 0, n - 1 - d);
+            double denominator = 0.0;
+            for (size_t k = first; k <= first + d; k = k + 1)
+            {
+                double product = 1.0;
+                for (size_t j = first; j <= first + d; j = j + 1)
+                {
+                    if (j != k)
+                    {
+                        product *= x[k] - x[j];
+                    }
+                }
+                row[k] = 1.0 / product / (targets[t] - x[k]);
+                denominator += row[k];
+            }
+            for (size_t k = first; k <= first + d; k = k + 1)
+            {
+                row[k] /= denominator;
+            }
+        }
+        return r;
+    }
+
+    // R V R^T of the n x n matrix "v" with the m x n interpolation matrix "r".
+    std::vector<double> interpolate(const std::vector<double> &v, const std::vector<double> &r, size_t n, size_t m)
+    {
+        std::vector<double> r_transposed(n * m), right, result;
+        for (size_t t = 0; t < m; t = t + 1)
+        {
+            for (size_t k = 0; k < n; k = k + 1)
+            {
+                r_transposed[k * m + t] = r[t * n + k];
+            }
+        }
+        linear_algebra::multiply(v, r_transposed, right, n, n, m);
+        linear_algebra::multiply(r, right, result, m, n, m);
+        return result;
+    }
+
+    // holdout points of a source mesh of "n" points, the first and the last point always stay.
+    std::vector<size_t> holdout_points(size_t n, size_t stride)
+    {
+        std::vector<size_t> holdout;
+        for (size_t k = stride - 1; k + 1 < n; k = k + stride)
+        {
+            holdout.push_back(k);
+        }
+        return holdout;
+    }
+
+    // range [first, last] of the holdout points around the momenta [low, high], one holdout point beyond each end.
+    std::pair<size_t, size_t> holdout_range(const std::vector<double> &holdout_momenta, double low, double high)
+    {
+        size_t first = std::upper_bound(holdout_momenta.begin(), holdout_momenta.end(), low) - holdout_momenta.begin();
+        size_t last = std::lower_bound(holdout_momenta.begin(), holdout_momenta.end(), high) - holdout_momenta.begin();
+        first = first > 0 ? first - 1 : 0;
+        last = std::min(last, holdout_momenta.size() - 1);
+        return {first, last};
+    }
+
+    // interpolated kernels of all channels of configs, with the exact fallback.
+    void run(const inifile_system::inifile &ini, const NN::NN_configs &configs)
+    {
+        auto st = read_settings(ini, configs);
+        const auto &channels = configs.partial_waves;
+        const auto &targets = configs.momentum_mesh_points;
+        size_t m = configs.mesh_points_number;
+
+        auto start = std::chrono::steady_clock::now();
+        auto src = read_source(st, configs);
+        size_t n = src.points.size();
+        auto r = interpolation_matrix(src.points, st.order, targets);
+
+        // holdout interpolation from the remaining points.
+        auto holdout = holdout_points(n, st.holdout_stride);
+        std::vector<size_t> kept;
+        std::vector<double> kept_momenta, holdout_momenta;
+        for (size_t k = 0, h = 0; k < n; k = k + 1)
+        {
+            if (h < holdout.size() && holdout[h] == k)
+            {
+                holdout_momenta.push_back(src.points[k]);
+                h = h + 1;
+                continue;
+            }
+            kept.push_back(k);
+            kept_momenta.push_back(src.points[k]);
+        }
+        bool estimate = !holdout.empty() && kept.size() >= 2;
+        std::vector<double> r_holdout;
+        if (estimate)
+        {
+            r_holdout = interpolation_matrix(kept_momenta, st.order, holdout_momenta);
+        }
+
+        // target blocks, exact outside the source mesh or without an estimate.
+        size_t blocks = (m + st.block - 1) / st.block;
+        std::vector<std::pair<double, double>> block_momenta(blocks);
+        std::vector<char> outside(blocks, 0);
+        for (size_t b = 0; b < blocks; b = b + 1)
+        {
+            block_momenta[b] = {targets[b * st.block], targets[std::min(m, (b + 1) * st.block) - 1]};
+            outside[b] = (block_momenta[b].first < src.points.front() || block_momenta[b].second > src.points.back()) ? 1 : 0;
+        }
+
+        // interpolation and estimates, the channels in parallel if there are enough of them, otherwise the matrix products.
+        std::vector<std::vector<double>> kernels(channels.size());
+        std::vector<std::vector<char>> exact(channels.size());
+        std::vector<double> channel_estimates(channels.size(), 0.0);
+        bool parallel_channels = channels.size() >= configs.thread_number;
+#pragma omp parallel for schedule(dynamic) if (parallel_channels)
+        for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+        {
+            const auto &v = src.kernels[idx];
+            double peak = 0.0;
+            for (double value : v)
+            {
+                peak = std::max(peak, std::fabs(value));
+            }
+            kernels[idx] = interpolate(v, r, n, m);
+
+            // |interpolated - source| at the holdout pairs.
+            size_t h = holdout.size();
+            std::vector<double> errors(h * h, 0.0);
+            if (estimate)
+            {
+                std::vector<double> v_kept(kept.size() * kept.size());
+                for (size_t a = 0; a < kept.size(); a = a + 1)
+                {
+                    for (size_t c = 0; c < kept.size(); c = c + 1)
+                    {
+                        v_kept[a * kept.size() + c] = v[kept[a] * n + kept[c]];
+                    }
+                }
+                auto v_holdout = interpolate(v_kept, r_holdout, kept.size(), h);
+                for (size_t a = 0; a < h; a = a + 1)
+                {
+                    for (size_t c = 0; c < h; c = c + 1)
+                    {
+                        errors[a * h + c] = std::fabs(v_holdout[a * h + c] - v[holdout[a] * n + holdout[c]]);
+                        channel_estimates[idx] = std::max(channel_estimates[idx], errors[a * h + c] / std::max(peak, 1e-300));
+                    }
+                }
+            }
+
+            exact[idx].assign(blocks * blocks, 0);
+            for (size_t b = 0; b < blocks * blocks; b = b + 1)
+            {
+                size_t bra = b / blocks, ket = b % blocks;
+                if (!estimate || outside[bra] || outside[ket])
+                {
+                    exact[idx][b] = 1;
+                    continue;
+                }
+                auto range_bra = holdout_range(holdout_momenta, block_momenta[bra].first, block_momenta[bra].second);
+                auto range_ket = holdout_range(holdout_momenta, block_momenta[ket].first, block_momenta[ket].second);
+                double block_error = 0.0;
+                for (size_t a = range_bra.first; a <= range_bra.second; a = a + 1)
+                {
+                    for (size_t c = range_ket.first; c <= range_ket.second; c = c + 1)
+                    {
+                        block_error = std::max(block_error, errors[a * h + c]);
+                    }
+                }
+                exact[idx][b] = block_error > st.tolerance * peak ? 1 : 0;
+            }
+        }
+        auto interpolation_end = std::chrono::steady_clock::now();
+
+        // exact fallback, one task per element of the flagged blocks.
+        std::vector<std::array<size_t, 3>> tasks;
+        std::vector<size_t> exact_elements(channels.size(), 0);
+        for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+        {
+            for (size_t i = 0; i < m; i = i + 1)
+            {
+                for (size_t k = 0; k < m; k = k + 1)
+                {
+                    if (exact[idx][(i / st.block) * blocks + k / st.block])
+                    {
+                        tasks.push_back({idx, i, k});
+                        exact_elements[idx] += 1;
+                    }
+                }
+            }
+        }
+#pragma omp parallel for schedule(dynamic)
+        for (size_t task = 0; task < tasks.size(); task = task + 1)
+        {
+            size_t idx = tasks[task][0], i = tasks[task][1], k = tasks[task][2];
+            const auto &channel = channels[idx];
+            kernels[idx][i * m + k] = interaction_all::potential_element(channel[0], channel[1], channel[2], channel[3], channel[4], targets[i], targets[k], configs);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        kernel_output::write_mesh_and_partial_waves(configs);
+        kernel_output::kernel_writer writer(configs);
+        for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+        {
+            writer.add(idx, kernels[idx]);
+        }
+        writer.print_compression();
+
+        std::cout.precision(3);
+        std::cout << "---- remeshing " << st.source_dir << st.source_name << " (" << n << " points) onto " << m << " points, degree " << std::min(st.order, n - 1)
+                  << ", holdout stride " << st.holdout_stride << "\n";
+        size_t total_exact = 0;
+        for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+        {
+            std::cout << "     " << kernel_output::channel_tag(channels[idx]) << ": holdout error " << std::scientific << channel_estimates[idx] << std::defaultfloat
+                      << " of the peak, " << exact_elements[idx] << " of " << m * m << " elements exact" << std::endl;
+            total_exact += exact_elements[idx];
+        }
+        std::cout << "     interpolation: " << std::chrono::duration<double>(interpolation_end - start).count() << " s, exact fallback (" << total_exact << " elements): "
+                  << std::chrono::duration<double>(end - interpolation_end).count() << " s" << std::endl;
+    }
+
+} // namespace remesh
+
+#endif // REMESH_HPP
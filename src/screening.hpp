@@ -0,0 +1,135 @@
+#pragma once
+#ifndef SCREENING_HPP
+#define SCREENING_HPP
+
+#include "interaction_all.hpp"
+#include "lib_define.hpp"
+
+// regulator screening of negligible matrix elements, switched on by "screening = true". every term of the
+// interaction is its unregulated part times exp(-(p'/Lambda)^2n - (p/Lambda)^2n) with its own regulator power n,
+// and the unregulated parts grow at most like Q^nu of the chiral order, nu = 0, 2, 3, 4 for lo .. n3lo. with r(p)
+// the largest regulator factor of all terms at p, the elements of a channel are bounded by the factorized
+//     |V(p', p)| <= K s(p') s(p),    s(p) = r(p) (1 + p^2 / Lambda^2)^(nu / 2 + 1),
+// where K is "safety" times the largest |V| / (s(p') s(p)) of probe elements of the channel: the first element of
+// every diagonal block and of every block of the first block row and column. a block of "screening_block" points
+// per direction whose bound is below "screening_tolerance" times the largest probe |V| of all channels is not
+// evaluated and written as exact zeros. a channel all blocks of which are screened is skipped as a whole.
+namespace screening
+{
+    // margin of the channel constant K over the probes.
+    constexpr double safety = 10.0;
+
+    struct plan
+    {
+        size_t n = 0;                   // momentum mesh points.
+        size_t block = 1;               // momentum points per block.
+        size_t blocks = 0;              // blocks per direction.
+        std::vector<char> skip;         // per block.
+        size_t skipped_elements = 0;    // elements written as zeros.
+        size_t probe_evaluations = 0;   // matrix elements evaluated for the bound.
+        bool skip_channel = false;      // all blocks screened.
+
+        bool skipped(size_t idx_mom_bra, size_t idx_mom_ket) const { return skip[(idx_mom_bra / block) * blocks + idx_mom_ket / block]; }
+    };
+
+    // s(p) of every point of the momentum mesh.
+    std::vector<double> envelope(const NN::NN_configs &configs)
+    {
+        const std::vector<size_t> powers = {configs.n_reg_Ctilde_1s0, configs.n_reg_Ctilde_3s1, configs.n_reg_C_1s0, configs.n_reg_C_3s1, configs.n_reg_C_1p1,
+                                            configs.n_reg_C_3p0, configs.n_reg_C_3p1, configs.n_reg_C_3sd1, configs.n_reg_C_3p2, configs.n_reg_one_pion_exchange,
+                                            configs.n_reg_two_pion_exchange_nlo, configs.n_reg_two_pion_exchange_n2lo, configs.n_reg_two_pion_exchange_n3lo};
+        const double chiral_power[] = {0.0, 2.0, 3.0, 4.0};
+        double growth = 0.5 * chiral_power[configs.chiral_order_index] + 1.0;
+        std::vector<double> s;
+        for (double p : configs.momentum_mesh_points)
+        {
+            double x = p / configs.Lambda;
+            double r = 0.0;
+            for (size_t n : powers)
+            {
+                r = std::max(r, std::exp(-std::pow(x, 2 * n)));
+            }
+            s.push_back(r * std::pow(1.0 + x * x, growth));
+        }
+        return s;
+    }
+
+    // screening plans of all channels of "configs", in the order of partial_waves.
+    std::vector<plan> make_plans(const NN::NN_configs &configs)
+    {
+        const auto &channels = configs.partial_waves;
+        const auto &points = configs.momentum_mesh_points;
+        auto s = envelope(configs);
+
+        // probes: channel constants K and the largest element of all channels.
+        std::vector<plan> plans(channels.size());
+        std::vector<double> constants(channels.size(), 0.0);
+        double scale = 0.0;
+        for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+        {
+            const auto &channel = channels[idx];
+            plan &pl = plans[idx];
+            pl.n = configs.mesh_points_number;
+            pl.block = configs.screening_block;
+            pl.blocks = (pl.n + pl.block - 1) / pl.block;
+            for (size_t b = 0; b < pl.blocks; b = b + 1)
+            {
+                std::vector<std::pair<size_t, size_t>> probes = {{b * pl.block, b * pl.block}};
+                if (b > 0)
+                {
+                    probes.push_back({0, b * pl.block});
+                    probes.push_back({b * pl.block, 0});
+                }
+                for (const auto &probe : probes)
+                {
+                    double v = interaction_all::potential_element(channel[0], channel[1], channel[2], channel[3], channel[4], points[probe.first], points[probe.second], configs);
+                    pl.probe_evaluations = pl.probe_evaluations + 1;
+                    scale = std::max(scale, std::fabs(v));
+                    constants[idx] = std::max(constants[idx], safety * std::fabs(v) / (s[probe.first] * s[probe.second]));
+                }
+            }
+        }
+
+        // blocks whose bound is below the tolerance.
+        double threshold = configs.screening_tolerance * scale;
+        for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+        {
+            plan &pl = plans[idx];
+            std::vector<double> block_envelope(pl.blocks, 0.0);
+            for (size_t k = 0; k < pl.n; k = k + 1)
+            {
+                block_envelope[k / pl.block] = std::max(block_envelope[k / pl.block], s[k]);
+            }
+            pl.skip.assign(pl.blocks * pl.blocks, 0);
+            for (size_t b = 0; b < pl.blocks * pl.blocks; b = b + 1)
+            {
+                size_t bra = b / pl.blocks, ket = b % pl.blocks;
+                if (constants[idx] * block_envelope[bra] * block_envelope[ket] < threshold)
+                {
+                    pl.skip[b] = 1;
+                    pl.skipped_elements += (std::min(pl.n, (bra + 1) * pl.block) - bra * pl.block) * (std::min(pl.n, (ket + 1) * pl.block) - ket * pl.block);
+                }
+            }
+            pl.skip_channel = (pl.skipped_elements == pl.n * pl.n);
+        }
+        return plans;
+    }
+
+    // one line summary of the plans of all channels.
+    void print_summary(const std::vector<plan> &plans)
+    {
+        size_t skipped = 0, elements = 0, channels = 0, probes = 0;
+        for (const auto &pl : plans)
+        {
+            skipped += pl.skipped_elements;
+            elements += pl.n * pl.n;
+            channels += pl.skip_channel ? 1 : 0;
+            probes += pl.probe_evaluations;
+        }
+        std::cout << "screening: " << skipped << " of " << elements << " matrix elements (" << std::fixed << std::setprecision(1) << 100.0 * skipped / std::max<size_t>(elements, 1)
+                  << " %) and " << channels << " of " << plans.size() << " channels written as zeros, " << probes << " probe elements" << std::defaultfloat << std::endl;
+    }
+
+} // namespace screening
+
+#endif // SCREENING_HPP
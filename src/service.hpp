@@ -0,0 +1,215 @@
+#pragma once
+#ifndef SERVICE_HPP
+#define SERVICE_HPP
+
+#include "manifest.hpp"
+#include "lib_define.hpp"
+#include <list>
+#include <map>
+#include <optional>
+
+// long-running mode "NN-cms.x --serve [base.ini]", reading one request per line from stdin and writing
+// the kernels to stdout. a request is a list of space separated tokens:
+//     channels=0-0-0-0-np,0-0-1-1-np interaction.C_1s0=2.2 momentum-mesh.mesh_points=60
+// "section.key=value" overrides a key of the base ini file for this request only, "channels" selects channels by
+// their file tag (default: all channels of the tables). the answer is the line "ok <channels> <n>", the
+// momentum mesh points and weights as 2 n doubles, and for every channel its tag on one line followed by
+// the n x n doubles of the kernel, row-major. a bad request is answered by "error <message>", "quit" stops.
+// the pion-exchange matrices of the last "cache_size" pion-exchange parameter sets are kept, so that
+// requests that only change contact terms cost the contact terms alone.
+namespace service
+{
+    struct cache_entry
+    {
+        NN::NN_configs configs;
+        std::map<std::vector<int>, std::vector<double>> pion_exchange;
+    };
+
+    class server
+    {
+    public:
+        server(const inifile_system::inifile &ini_base, size_t cache_size) : ini_base(ini_base), cache_size(cache_size) {}
+
+        // answer one request line on "out", false for "quit".
+        bool handle(const std::string &line, std::ostream &out)
+        {
+            std::istringstream iss(line);
+            std::vector<std::string> tokens;
+            std::string token;
+            while (iss >> token)
+            {
+                tokens.push_back(token);
+            }
+            if (tokens.empty())
+            {
+                return true;
+            }
+            if (tokens[0] == "quit")
+            {
+                return false;
+            }
+
+            auto ini = ini_base;
+            std::string channel_list = "all";
+            for (const auto &tok : tokens)
+            {
+                auto pos_eq = tok.find('=');
+                auto pos_dot = tok.find('.');
+                if (pos_eq == std::string::npos)
+                {
+                    out << "error token without '=': " << tok << "\n";
+                    out.flush();
+                    return true;
+                }
+                std::string key = tok.substr(0, pos_eq);
+                std::string value = tok.substr(pos_eq + 1);
+                if (key == "channels")
+                {
+                    channel_list = value;
+                }
+                else if (pos_dot != std::string::npos && pos_dot < pos_eq)
+                {
+                    std::string name = key.substr(0, pos_dot);
+                    std::string name_key = key.substr(pos_dot + 1);
+                    if (!ini_base.has_section(name) || !ini_base.section(name).has_key(name_key))
+                    {
+                        out << "error key not in the base ini file: " << key << "\n";
+                        out.flush();
+                        return true;
+                    }
+                    ini.section(name).set_string(name_key, value);
+                }
+                else
+                {
+                    out << "error override needs the form section.key=value: " << tok << "\n";
+                    out.flush();
+                    return true;
+                }
+            }
+
+            std::optional<NN::NN_configs> parsed;
+            try
+            {
+                parsed.emplace(ini);
+            }
+            catch (const std::exception &e)
+            {
+                out << "error " << e.what() << "\n";
+                out.flush();
+                return true;
+            }
+            const auto &configs = *parsed;
+            std::vector<std::vector<int>> channels;
+            if (channel_list == "all")
+            {
+                channels = configs.partial_waves;
+            }
+            else
+            {
+                std::istringstream iss_channels(channel_list);
+                std::string tag;
+                while (std::getline(iss_channels, tag, ','))
+                {
+                    auto pos = std::find_if(configs.partial_waves.begin(), configs.partial_waves.end(), [&tag](const std::vector<int> &channel)
+                                            { return kernel_output::channel_tag(channel) == tag; });
+                    if (pos == configs.partial_waves.end())
+                    {
+                        out << "error channel not in the tables: " << tag << "\n";
+                        out.flush();
+                        return true;
+                    }
+                    channels.push_back(*pos);
+                }
+            }
+
+            size_t n = configs.mesh_points_number;
+            out << "ok " << channels.size() << " " << n << "\n";
+            out.write(reinterpret_cast<const char *>(configs.momentum_mesh_points.data()), n * sizeof(double));
+            out.write(reinterpret_cast<const char *>(configs.momentum_mesh_weights.data()), n * sizeof(double));
+            // screening bounds are relative to the largest probe element of all channels of the tables.
+            std::vector<screening::plan> screens;
+            if (configs.screening)
+            {
+                screens = screening::make_plans(configs);
+            }
+            for (const auto &this_channel : channels)
+            {
+                size_t idx_channel = std::find(configs.partial_waves.begin(), configs.partial_waves.end(), this_channel) - configs.partial_waves.begin();
+                auto v = kernel(this_channel, configs, screens.empty() ? nullptr : &screens[idx_channel]);
+                out << kernel_output::channel_tag(this_channel) << "\n";
+                out.write(reinterpret_cast<const char *>(v.data()), n * n * sizeof(double));
+            }
+            out.flush();
+            return true;
+        }
+
+    private:
+        inifile_system::inifile ini_base;
+        size_t cache_size;
+        std::list<cache_entry> cache; // most recently used first.
+
+        // kernel of one channel, from the cached pion-exchange part when possible, with the screening plan "screen".
+        std::vector<double> kernel(const std::vector<int> &this_channel, const NN::NN_configs &configs, const screening::plan *screen)
+        {
+            if (!manifest::shareable(configs))
+            {
+                // like a normal run, with the adaptive angular plan and screening. its log goes to stderr, stdout
+                // carries the answer.
+                std::streambuf *answer = std::cout.rdbuf(std::cerr.rdbuf());
+                auto v = kernel_output::compute_channel(this_channel, configs, screen);
+                std::cout.rdbuf(answer);
+                return v;
+            }
+
+            auto pos = std::find_if(cache.begin(), cache.end(), [&configs](const cache_entry &entry)
+                                    { return manifest::same_pion_exchange(entry.configs, configs); });
+            if (pos == cache.end())
+            {
+                cache.push_front({configs, {}});
+                if (cache.size() > cache_size)
+                {
+                    cache.pop_back();
+                }
+            }
+            else
+            {
+                cache.splice(cache.begin(), cache, pos);
+            }
+            auto &pion_exchange = cache.front().pion_exchange;
+            if (pion_exchange.count(this_channel) == 0)
+            {
+                pion_exchange[this_channel] = manifest::pion_exchange_matrix(this_channel, configs);
+            }
+            return manifest::add_contact(this_channel, configs, pion_exchange[this_channel]);
+        }
+    };
+
+    // serve requests from stdin until "quit" or end of input, log messages go to stderr.
+    void run(const std::string &file_base, size_t cache_size)
+    {
+        auto ini_base = inifile_system::inifile(file_base);
+        if (!ini_base.good())
+        {
+            std::cerr << ini_base.error() << std::endl;
+            exit(-1);
+        }
+        // the base settings must be valid, they give the threads of the requests.
+        omp_set_num_threads(NN::NN_configs(ini_base).thread_number);
+        server srv(ini_base, cache_size);
+        std::cerr << "---- serving requests from stdin, base: " << file_base << std::endl;
+        std::string line;
+        while (std::getline(std::cin, line))
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            if (!srv.handle(line, std::cout))
+            {
+                break;
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            std::cerr << "request done in " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+        }
+    }
+
+} // namespace service
+
+#endif // SERVICE_HPP
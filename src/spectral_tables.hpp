@@ -0,0 +1,406 @@
+#pragma once
+#ifndef SPECTRAL_TABLES_HPP
+#define SPECTRAL_TABLES_HPP
+
+#include "basic_math.hpp"
+#include <array>
+#include <cmath>
+#include <vector>
+
+// subleading two-pion-exchange terms given by their spectral functions Im V(i mu), with the spectral
+// cutoff Lambda_tilde as in loop_function_L and loop_function_A:
+//     V_C(q) = -(2 q^6 / Pi) int_{2 m}^{Lambda_tilde} dmu Im V_C(i mu) / (mu^5 (mu^2 + q^2)),
+//     V_T(q) =  (2 q^4 / Pi) int_{2 m}^{Lambda_tilde} dmu Im V_T(i mu) / (mu^3 (mu^2 + q^2)),
+// and the same for W_C and W_T, see R. Machleidt and D. R. Entem, Phys. Rept. 503 (2011) 1.
+// the integrals J(q) are tabulated once per run on a uniform q-grid together with dJ/dq and are
+// interpolated by cubic hermite polynomials in the angular loop.
+namespace spectral_tables
+{
+    constexpr double PI = 3.141592653589793;
+
+    enum component
+    {
+        v_c, // isoscalar central.
+        w_c, // isovector central.
+        v_t, // isoscalar tensor, V_S = -q^2 V_T.
+        w_t, // isovector tensor, W_S = -q^2 W_T.
+        component_number
+    };
+
+    // low-energy constants and masses entering the two-loop spectral functions, in MeV.
+    struct parameters
+    {
+        double ga, fpi, mpi, lambda_tilde;
+        double d1_plus_d2, d3, d5, d14_minus_d15;
+    };
+
+    struct table
+    {
+        bool ready = false;
+        double q_max = 0.0;
+        double h = 0.0;
+        std::array<std::vector<double>, component_number> value;
+        std::array<std::vector<double>, component_number> derivative;
+
+        // spectral quadrature: nodes mu, weights including the jacobian and 1/mu^5 (central) or 1/mu^3 (tensor) times Im V(i mu).
+        std::vector<double> mu;
+        std::array<std::vector<double>, component_number> spectral_weight;
+    };
+
+    // (1 + z^2)^(3/2) asinh(z) / z^3 - 1 / z^2 + 1/6, the 1/z^2 terms cancel for small z.
+    double tensor_bracket(double z)
+    {
+        if (z < 0.02)
+        {
+            double z2 = z * z;
+            return 1.5 + z2 * (1.0 / 5.0 + z2 * (-2.0 / 35.0 + z2 * 8.0 / 315.0));
+        }
+        double z2 = z * z;
+        return 1.0 / 6.0 - 1.0 / z2 + std::pow(1.0 + z2, 1.5) * std::asinh(z) / (z2 * z);
+    }
+
+    // two-loop spectral functions at mu > 2 m, kappa = sqrt(mu^2 / 4 - m^2) is passed along since mu - 2 m
+    // cancels near threshold, ln((mu + 2 m) / (mu - 2 m)) = 2 ln((mu + 2 m) / (2 kappa)).
+    double im_v_c(double mu, double kappa, const parameters &par)
+    {
+        double m = par.mpi, m2 = m * m, mu2 = mu * mu;
+        double ga2 = par.ga * par.ga;
+        double f6 = std::pow(4.0 * par.fpi, 6);
+        double log_mu = 2.0 * std::log((mu + 2.0 * m) / (2.0 * kappa));
+        return 3.0 * ga2 * ga2 * (2.0 * m2 - mu2) / (PI * mu * f6) *
+               ((m2 - 2.0 * mu2) * (2.0 * m + (2.0 * m2 - mu2) / (2.0 * mu) * log_mu) + 4.0 * ga2 * m * (2.0 * m2 - mu2));
+    }
+
+    double im_w_c(double mu, double kappa, const parameters &par)
+    {
+        double m = par.mpi, m2 = m * m, mu2 = mu * mu;
+        double ga2 = par.ga * par.ga;
+        double ff = par.fpi * par.fpi;
+        double k2 = kappa * kappa;
+        double log_kappa = std::log((mu + 2.0 * kappa) / (2.0 * m));
+        const auto &rule = basic_math::gauss_legendre_rule(8, 0.0, 1.0);
+        double sum = 0.0;
+        for (size_t i = 0; i < rule.nodes.size(); i = i + 1)
+        {
+            double x2 = rule.nodes[i] * rule.nodes[i];
+            double outer = ga2 * (mu2 - 2.0 * m2) + 2.0 * (1.0 - ga2) * k2 * x2;
+            double inner = 96.0 * PI * PI * ff * ((2.0 * m2 - mu2) * par.d1_plus_d2 - 2.0 * k2 * x2 * par.d3 + 4.0 * ga2 * m2 * par.d5) +
+                           (4.0 * m2 * (1.0 + 2.0 * ga2) - mu2 * (1.0 + 5.0 * ga2)) * kappa / mu * log_kappa + mu2 / 12.0 * (5.0 + 13.0 * ga2) - 2.0 * m2 * (1.0 + 2.0 * ga2);
+            sum += rule.weights[i] * outer * inner;
+        }
+        return 2.0 * kappa / (3.0 * mu * std::pow(8.0 * PI * ff, 3)) * sum;
+    }
+
+    // Im V_T = Im V_S / mu^2.
+    double im_v_t(double mu, double kappa, const parameters &par)
+    {
+        double m = par.mpi, mu2 = mu * mu;
+        double ga2 = par.ga * par.ga;
+        double ff = par.fpi * par.fpi;
+        double k3 = kappa * kappa * kappa;
+        const auto &rule = basic_math::gauss_legendre_rule(16, 0.0, 1.0);
+        double sum = 0.0;
+        for (size_t i = 0; i < rule.nodes.size(); i = i + 1)
+        {
+            double x = rule.nodes[i];
+            sum += rule.weights[i] * (1.0 - x * x) * tensor_bracket(kappa * x / m);
+        }
+        double im_v_s = ga2 * mu * k3 / (8.0 * PI * ff * ff) * par.d14_minus_d15 * par.d14_minus_d15 + 2.0 * ga2 * ga2 * ga2 * mu * k3 / std::pow(8.0 * PI * ff, 3) * sum;
+        return im_v_s / mu2;
+    }
+
+    // Im W_T = Im W_S / mu^2.
+    double im_w_t(double mu, double kappa, const parameters &par)
+    {
+        double m = par.mpi, m2 = m * m, mu2 = mu * mu;
+        double ga2 = par.ga * par.ga;
+        double f6 = std::pow(4.0 * par.fpi, 6);
+        double log_mu = 2.0 * std::log((mu + 2.0 * m) / (2.0 * kappa));
+        double im_w_s = ga2 * ga2 * (4.0 * m2 - mu2) / (PI * f6) * ((m2 - mu2 / 4.0) * log_mu + (1.0 + 2.0 * ga2) * mu * m);
+        return im_w_s / mu2;
+    }
+
+    // J(q) and dJ/dq of one component from the spectral quadrature.
+    void integral(const table &tab, int comp, double q, double &j, double &djdq)
+    {
+        j = 0.0;
+        djdq = 0.0;
+        double q2 = q * q;
+        for (size_t i = 0; i < tab.mu.size(); i = i + 1)
+        {
+            double den = 1.0 / (tab.mu[i] * tab.mu[i] + q2);
+            j += tab.spectral_weight[comp][i] * den;
+            djdq += -2.0 * q * tab.spectral_weight[comp][i] * den * den;
+        }
+    }
+
+    // tabulate the four components for 0 <= q <= q_max.
+    table build(const parameters &par, double q_max, size_t grid_points, size_t spectral_points)
+    {
+        table tab;
+        tab.q_max = q_max;
+        tab.h = q_max / (grid_points - 1);
+
+        // mu^2 = 4 m^2 + s^2 and s = s_max t^2 remove the threshold singularities, kappa = s / 2.
+        double m = par.mpi;
+        if (par.lambda_tilde > 2.0 * m)
+        {
+            double s_max = std::sqrt(par.lambda_tilde * par.lambda_tilde - 4.0 * m * m);
+            const auto &rule = basic_math::gauss_legendre_rule(spectral_points, 0.0, 1.0);
+            for (size_t i = 0; i < rule.nodes.size(); i = i + 1)
+            {
+                double t = rule.nodes[i];
+                double s = s_max * t * t;
+                double mu = std::sqrt(4.0 * m * m + s * s);
+                double jacobian = s / mu * 2.0 * s_max * t * rule.weights[i];
+                double mu3 = mu * mu * mu;
+                double mu5 = mu3 * mu * mu;
+                tab.mu.push_back(mu);
+                tab.spectral_weight[v_c].push_back(jacobian * im_v_c(mu, 0.5 * s, par) / mu5);
+                tab.spectral_weight[w_c].push_back(jacobian * im_w_c(mu, 0.5 * s, par) / mu5);
+                tab.spectral_weight[v_t].push_back(jacobian * im_v_t(mu, 0.5 * s, par) / mu3);
+                tab.spectral_weight[w_t].push_back(jacobian * im_w_t(mu, 0.5 * s, par) / mu3);
+            }
+        }
+
+        for (int comp = 0; comp < component_number; comp = comp + 1)
+        {
+            tab.value[comp].resize(grid_points);
+            tab.derivative[comp].resize(grid_points);
+            for (size_t k = 0; k < grid_points; k = k + 1)
+            {
+                integral(tab, comp, k * tab.h, tab.value[comp][k], tab.derivative[comp][k]);
+            }
+        }
+        tab.ready = true;
+        return tab;
+    }
+
+    // J(q) by cubic hermite interpolation, direct quadrature beyond q_max.
+    template <typename T>
+    T interpolate(const table &tab, int comp, const T &q)
+    {
+        double qd = static_cast<double>(q);
+        if (qd >= tab.q_max)
+        {
+            double j, djdq;
+            integral(tab, comp, qd, j, djdq);
+            return T(j);
+        }
+        size_t k = static_cast<size_t>(qd / tab.h);
+        T t = (q - T(k * tab.h)) / T(tab.h);
+        T t2 = t * t;
+        T t3 = t2 * t;
+        T h00 = T(2.0) * t3 - T(3.0) * t2 + T(1.0);
+        T h10 = t3 - T(2.0) * t2 + t;
+        T h01 = -T(2.0) * t3 + T(3.0) * t2;
+        T h11 = t3 - t2;
+        const auto &v = tab.value[comp];
+        const auto &d = tab.derivative[comp];
+        return h00 * T(v[k]) + h10 * T(tab.h * d[k]) + h01 * T(v[k + 1]) + h11 * T(tab.h * d[k + 1]);
+    }
+
+    // V_C or W_C at momentum transfer q.
+    template <typename T>
+    T central(const table &tab, int comp, const T &q)
+    {
+        T q2 = q * q;
+        return -T(2.0 / PI) * q2 * q2 * q2 * interpolate(tab, comp, q);
+    }
+
+    // V_T or W_T at momentum transfer q.
+    template <typename T>
+    T tensor(const table &tab, int comp, const T &q)
+    {
+        T q2 = q * q;
+        return T(2.0 / PI) * q2 * q2 * interpolate(tab, comp, q);
+    }
+
+    // yukawa expansion of the two-pion exchange for "tpe_projection = spectral", see tpe_projection.hpp: every
+    // f-component of every order is, with t = q^2,
+    //     f(t) = sum_k polynomial[k] t^k + sum_n residue[n] / (mass[n]^2 + t),
+    // from the spectral representations of the loop functions with L(0) = sqrt(Lambda_tilde^2 - 4 m^2) / Lambda_tilde,
+    //     A(t) = 1/2 int dmu 1 / (mu^2 + t),
+    //     L(t) = L(0) + t int dmu sqrt(mu^2 - 4 m^2) / mu^2 / (mu^2 + t),
+    //     L(t) / (4 m^2 + t) = int dmu 1 / sqrt(mu^2 - 4 m^2) / (mu^2 + t),
+    // discretized with mu^2 = 4 m^2 + s^2 and a gauss-legendre rule in s, and of the two-loop terms with the nodes of
+    // the spectral table. a polynomial P(t) times 1 / (mu^2 + t) is divided into a polynomial and P(-mu^2) / (mu^2 + t).
+    enum expansion_order
+    {
+        nlo_terms,
+        n2lo_terms,
+        n3lo_terms,
+        expansion_order_number
+    };
+
+    enum expansion_part
+    {
+        isoscalar, // independent of the isospin factor.
+        isovector, // times the isospin factor of the channel.
+        expansion_part_number
+    };
+
+    enum expansion_component
+    {
+        central_f1,
+        spin_f2,
+        tensor_f6,
+        expansion_component_number
+    };
+
+    struct yukawa_sum
+    {
+        std::vector<double> polynomial; // coefficients of t^k.
+        std::vector<double> residue;    // per mass.
+    };
+
+    struct yukawa_expansion
+    {
+        bool ready = false;
+        std::vector<double> mass;
+        std::array<std::array<std::array<yukawa_sum, expansion_component_number>, expansion_part_number>, expansion_order_number> terms;
+    };
+
+    // G(t) = infinity + sum_n weight[n] / (mass[offset + n]^2 + t).
+    struct spectrum
+    {
+        double infinity;
+        std::vector<double> weight;
+        size_t offset;
+    };
+
+    std::vector<double> polynomial_product(const std::vector<double> &a, const std::vector<double> &b)
+    {
+        std::vector<double> c(a.size() + b.size() - 1, 0.0);
+        for (size_t i = 0; i < a.size(); i = i + 1)
+        {
+            for (size_t k = 0; k < b.size(); k = k + 1)
+            {
+                c[i + k] += a[i] * b[k];
+            }
+        }
+        return c;
+    }
+
+    // adds P(t) G(t) to "target".
+    void add_product(yukawa_sum &target, const std::vector<double> &mass, const std::vector<double> &p, const spectrum &g)
+    {
+        if (target.polynomial.size() < p.size())
+        {
+            target.polynomial.resize(p.size(), 0.0);
+        }
+        target.residue.resize(mass.size(), 0.0);
+        for (size_t k = 0; k < p.size(); k = k + 1)
+        {
+            target.polynomial[k] += g.infinity * p[k];
+        }
+        for (size_t n = 0; n < g.weight.size(); n = n + 1)
+        {
+            // synthetic division of P(t) by t + mu^2.
+            double root = -mass[g.offset + n] * mass[g.offset + n];
+            double carry = 0.0;
+            for (size_t k = p.size(); k-- > 1;)
+            {
+                carry = p[k] + root * carry;
+                target.polynomial[k - 1] += g.weight[n] * carry;
+            }
+            target.residue[g.offset + n] += g.weight[n] * (p[0] + root * carry);
+        }
+    }
+
+    // expansion of the two-pion exchange up to "order_index" (1 = nlo .. 3 = n3lo) with the low-energy constants
+    // c = {c1, c2, c3, c4}, "spectral_points" nodes for the one-loop functions and the nodes of "two_loop" at n3lo.
+    yukawa_expansion build_yukawa_expansion(const parameters &par, const std::array<double, 4> &c, int order_index, size_t spectral_points, const table &two_loop)
+    {
+        yukawa_expansion ex;
+        double m = par.mpi, m2 = m * m, m4 = m2 * m2;
+        double ga2 = par.ga * par.ga, ga4 = ga2 * ga2;
+        double f4 = std::pow(par.fpi, 4);
+        spectrum loop_a{0.0, {}, 0}, loop_l{0.0, {}, 0}, loop_h{0.0, {}, 0};
+        if (par.lambda_tilde > 2.0 * m)
+        {
+            double s_max = std::sqrt(par.lambda_tilde * par.lambda_tilde - 4.0 * m2);
+            loop_l.infinity = s_max / par.lambda_tilde;
+            const auto &rule = basic_math::gauss_legendre_rule(spectral_points, 0.0, s_max);
+            for (size_t i = 0; i < rule.nodes.size(); i = i + 1)
+            {
+                double s = rule.nodes[i], w = rule.weights[i];
+                double mu = std::sqrt(4.0 * m2 + s * s);
+                ex.mass.push_back(mu);
+                // dmu = s ds / mu.
+                loop_a.weight.push_back(0.5 * s / mu * w);
+                loop_l.infinity += s * s / (mu * mu * mu) * w;
+                loop_l.weight.push_back(-s * s / mu * w);
+                loop_h.weight.push_back(w / mu);
+            }
+        }
+        spectrum two_loop_v_c{0.0, {}, ex.mass.size()}, two_loop_w_c = two_loop_v_c, two_loop_v_t = two_loop_v_c, two_loop_w_t = two_loop_v_c;
+        if (order_index >= 3)
+        {
+            ex.mass.insert(ex.mass.end(), two_loop.mu.begin(), two_loop.mu.end());
+            two_loop_v_c.weight = two_loop.spectral_weight[v_c];
+            two_loop_w_c.weight = two_loop.spectral_weight[w_c];
+            two_loop_v_t.weight = two_loop.spectral_weight[v_t];
+            two_loop_w_t.weight = two_loop.spectral_weight[w_t];
+        }
+        for (auto &order : ex.terms)
+        {
+            for (auto &part : order)
+            {
+                for (auto &sum : part)
+                {
+                    sum.residue.assign(ex.mass.size(), 0.0);
+                }
+            }
+        }
+
+        // f2 = -t f6 of every order.
+        auto add_tensor = [&](int order, int part, const std::vector<double> &p, const spectrum &g)
+        {
+            add_product(ex.terms[order][part][tensor_f6], ex.mass, p, g);
+            add_product(ex.terms[order][part][spin_f2], ex.mass, polynomial_product(p, {0.0, -1.0}), g);
+        };
+
+        if (order_index >= 1)
+        {
+            double k = 1.0 / (384.0 * PI * PI * f4);
+            std::vector<double> central = {k * 4.0 * m2 * (1.0 + 4.0 * ga2 - 5.0 * ga4), k * (1.0 + 10.0 * ga2 - 23.0 * ga4)};
+            add_product(ex.terms[nlo_terms][isovector][central_f1], ex.mass, central, loop_l);
+            add_product(ex.terms[nlo_terms][isovector][central_f1], ex.mass, {-k * 48.0 * ga4 * m4}, loop_h);
+            add_tensor(nlo_terms, isoscalar, {-3.0 * ga4 / (64.0 * PI * PI * f4)}, loop_l);
+        }
+        if (order_index >= 2)
+        {
+            double k = 3.0 * ga2 / (16.0 * PI * f4);
+            add_product(ex.terms[n2lo_terms][isoscalar][central_f1], ex.mass, polynomial_product({k * 2.0 * m2 * (c[2] - 2.0 * c[0]), k * c[2]}, {2.0 * m2, 1.0}), loop_a);
+            double kt = -ga2 / (32.0 * PI * f4) * c[3];
+            add_tensor(n2lo_terms, isovector, {kt * 4.0 * m2, kt}, loop_a);
+        }
+        if (order_index >= 3)
+        {
+            // football diagram.
+            std::vector<double> part1 = {c[1] / 6.0 * 4.0 * m2 + c[2] * 2.0 * m2 - 4.0 * c[0] * m2, c[1] / 6.0 + c[2]};
+            std::vector<double> w2 = {4.0 * m2, 1.0};
+            std::vector<double> central = polynomial_product(part1, part1);
+            auto part2 = polynomial_product(w2, w2);
+            for (size_t i = 0; i < central.size(); i = i + 1)
+            {
+                central[i] = 3.0 / (16.0 * PI * PI * f4) * (central[i] + c[1] * c[1] / 45.0 * part2[i]);
+            }
+            add_product(ex.terms[n3lo_terms][isoscalar][central_f1], ex.mass, central, loop_l);
+            double kt = c[3] * c[3] / (96.0 * PI * PI * f4);
+            add_tensor(n3lo_terms, isovector, {kt * 4.0 * m2, kt}, loop_l);
+
+            // two-loop terms.
+            add_product(ex.terms[n3lo_terms][isoscalar][central_f1], ex.mass, {0.0, 0.0, 0.0, -2.0 / PI}, two_loop_v_c);
+            add_product(ex.terms[n3lo_terms][isovector][central_f1], ex.mass, {0.0, 0.0, 0.0, -2.0 / PI}, two_loop_w_c);
+            add_tensor(n3lo_terms, isoscalar, {0.0, 0.0, 2.0 / PI}, two_loop_v_t);
+            add_tensor(n3lo_terms, isovector, {0.0, 0.0, 2.0 / PI}, two_loop_w_t);
+        }
+        ex.ready = true;
+        return ex;
+    }
+
+} // namespace spectral_tables
+
+#endif // SPECTRAL_TABLES_HPP
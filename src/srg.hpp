@@ -0,0 +1,280 @@
+#pragma once
+#ifndef SRG_HPP
+#define SRG_HPP
+
+#include "kernel_output.hpp"
+#include "linear_algebra.hpp"
+#include "lib_define.hpp"
+#include <algorithm>
+#include <numeric>
+
+// "NN-cms.x --srg": similarity renormalization group evolution of the kernels of the channel tables,
+//     dH/ds = [[T, H], H],    s = 1 / lambda^4,
+// with the relative kinetic energy T = p^2 / mass_nucleon. a channel, or the 2n x 2n block [[--, -+], [+-, ++]]
+// of a coupled (j, tz), is evolved as the symmetric matrix sqrt(w_i) p_i V(p_i, p_k) p_k sqrt(w_k) in units of
+// hbar^2 / mass_nucleon = 1, so that s is in fm^4 and lambda in fm^-1. the flow is integrated with the embedded
+// runge-kutta 5(4) rule of dormand and prince with adaptive steps, each stage costs one matrix product:
+// with eta = [T, H] antisymmetric, [eta, H] = eta H + (eta H)^T.
+namespace srg
+{
+    struct settings
+    {
+        std::vector<double> lambdas; // fm^-1, decreasing.
+        double tolerance;            // error of one step relative to the largest element.
+    };
+
+    // optional [srg] section, "lambdas = 3.0, 2.5, 2.0".
+    settings read_settings(const inifile_system::inifile &ini)
+    {
+        settings st{{2.0}, 1e-10};
+        if (ini.has_section("srg"))
+        {
+            auto sec = ini.section("srg");
+            if (sec.has_key("lambdas"))
+            {
+                st.lambdas.clear();
+                std::istringstream iss(sec.get_string("lambdas"));
+                std::string value;
+                while (std::getline(iss, value, ','))
+                {
+                    st.lambdas.push_back(std::stod(value));
+                }
+            }
+            st.tolerance = sec.has_key("tolerance") ? sec.get_double("tolerance") : st.tolerance;
+        }
+        std::sort(st.lambdas.begin(), st.lambdas.end(), std::greater<double>());
+        if (st.lambdas.empty() || st.lambdas.back() <= 0.0 || st.tolerance <= 0.0)
+        {
+            std::cerr << "srg needs positive lambdas and tolerance > 0" << std::endl;
+            exit(-1);
+        }
+        return st;
+    }
+
+    // result_name of the kernels evolved to "lambda", e.g. "n2lo-emn500-srg2.00".
+    std::string evolved_name(const std::string &result_name, double lambda)
+    {
+        std::ostringstream oss;
+        oss << result_name << "-srg" << std::fixed << std::setprecision(2) << lambda;
+        return oss.str();
+    }
+
+    // ds H = [[T, H], H] for the diagonal "t" and symmetric "h" of dimension "dim", "x" is scratch space.
+    void flow(const std::vector<double> &t, const std::vector<double> &h, size_t dim, std::vector<double> &eta, std::vector<double> &x, std::vector<double> &dh)
+    {
+        eta.resize(dim * dim);
+        for (size_t i = 0; i < dim; i = i + 1)
+        {
+            for (size_t k = 0; k < dim; k = k + 1)
+            {
+                eta[i * dim + k] = (t[i] - t[k]) * h[i * dim + k];
+            }
+        }
+        linear_algebra::multiply(eta, h, x, dim);
+        dh.resize(dim * dim);
+        for (size_t i = 0; i < dim; i = i + 1)
+        {
+            for (size_t k = 0; k < dim; k = k + 1)
+            {
+                dh[i * dim + k] = x[i * dim + k] + x[k * dim + i];
+            }
+        }
+    }
+
+    // evolve "h" (kinetic energy "t" on the diagonal included) from s = 0 through every "s_targets", increasing,
+    // the evolved matrices are returned in order. "steps" counts the accepted steps.
+    std::vector<std::vector<double>> evolve(const std::vector<double> &t, std::vector<double> h, size_t dim, const std::vector<double> &s_targets, double tolerance, size_t &steps)
+    {
+        // dormand-prince 5(4) tableau, the flow does not depend on s explicitly.
+        static const double a[7][6] = {{},
+                                       {1.0 / 5.0},
+                                       {3.0 / 40.0, 9.0 / 40.0},
+                                       {44.0 / 45.0, -56.0 / 15.0, 32.0 / 9.0},
+                                       {19372.0 / 6561.0, -25360.0 / 2187.0, 64448.0 / 6561.0, -212.0 / 729.0},
+                                       {9017.0 / 3168.0, -355.0 / 33.0, 46732.0 / 5247.0, 49.0 / 176.0, -5103.0 / 18656.0},
+                                       {35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0}};
+        // difference of the 5th and 4th order weights.
+        static const double e[7] = {71.0 / 57600.0, 0.0, -71.0 / 16695.0, 71.0 / 1920.0, -17253.0 / 339200.0, 22.0 / 525.0, -1.0 / 40.0};
+
+        std::vector<std::vector<double>> evolved;
+        std::vector<std::vector<double>> k(7);
+        std::vector<double> stage(dim * dim), eta, x, h_new(dim * dim);
+        double s = 0.0;
+        double step = 1e-4 * s_targets.front();
+        steps = 0;
+        flow(t, h, dim, eta, x, k[0]);
+        for (double s_target : s_targets)
+        {
+            while (s < s_target)
+            {
+                bool last = (s + step >= s_target);
+                double hs = last ? s_target - s : step;
+                for (size_t st = 1; st < 7; st = st + 1)
+                {
+                    for (size_t idx = 0; idx < dim * dim; idx = idx + 1)
+                    {
+                        double sum = 0.0;
+                        for (size_t sp = 0; sp < st; sp = sp + 1)
+                        {
+                            sum += a[st][sp] * k[sp][idx];
+                        }
+                        stage[idx] = h[idx] + hs * sum;
+                    }
+                    flow(t, stage, dim, eta, x, k[st]);
+                }
+                // the last stage is the 5th order solution h_new.
+                h_new = stage;
+                double error = 0.0, scale = 0.0;
+                for (size_t idx = 0; idx < dim * dim; idx = idx + 1)
+                {
+                    double diff = 0.0;
+                    for (size_t st = 0; st < 7; st = st + 1)
+                    {
+                        diff += e[st] * k[st][idx];
+                    }
+                    error = std::max(error, std::abs(hs * diff));
+                    scale = std::max(scale, std::abs(h_new[idx]));
+                }
+                error = error / (tolerance * scale);
+                if (error <= 1.0)
+                {
+                    s = last ? s_target : s + hs;
+                    h.swap(h_new);
+                    k[0].swap(k[6]); // first same as last.
+                    steps = steps + 1;
+                }
+                double factor = error > 0.0 ? 0.9 * std::pow(error, -0.2) : 5.0;
+                step = hs * std::min(5.0, std::max(0.2, factor));
+            }
+            evolved.push_back(h);
+        }
+        return evolved;
+    }
+
+    // evolve all channels of the tables and write the kernels of every lambda in the layout of [output],
+    // under the result_name "result_name-srg<lambda>".
+    void run(const inifile_system::inifile &ini, const NN::NN_configs &configs)
+    {
+        auto st = read_settings(ini);
+        size_t n = configs.mesh_points_number;
+        const auto &channels = configs.partial_waves;
+        const auto &p = configs.momentum_mesh_points;
+        const auto &w = configs.momentum_mesh_weights;
+        // MeV to units of hbar^2 / mass_nucleon = 1: energies in fm^-2.
+        const double to_fm = configs.mass_nucleon / (constants::hbarc * constants::hbarc);
+        std::vector<double> s_targets;
+        for (double lambda : st.lambdas)
+        {
+            s_targets.push_back(1.0 / std::pow(lambda, 4));
+        }
+
+        // first channel of every group and its size, 1 or 4.
+        std::vector<std::pair<size_t, size_t>> groups;
+        for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+        {
+            size_t size = kernel_output::coupled_group(channels, idx) ? 4 : 1;
+            groups.push_back({idx, size});
+            idx = idx + size - 1;
+        }
+
+        // mesh kernels, with the angular integration parallel.
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::vector<double>> kernels(channels.size());
+        for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+        {
+            kernels[idx] = kernel_output::compute_channel(channels[idx], configs);
+        }
+        auto kernels_end = std::chrono::steady_clock::now();
+
+        // the channels in parallel if there are enough of them, otherwise the matrix products.
+        std::vector<double> f(n);
+        for (size_t i = 0; i < n; i = i + 1)
+        {
+            f[i] = std::sqrt(w[i]) * p[i];
+        }
+        std::vector<std::vector<std::vector<double>>> evolved(channels.size()); // [channel][lambda], n x n in MeV^-2.
+        std::vector<size_t> steps(groups.size());
+        bool parallel_channels = groups.size() >= configs.thread_number;
+#pragma omp parallel for schedule(dynamic) if (parallel_channels)
+        for (size_t g = 0; g < groups.size(); g = g + 1)
+        {
+            size_t first = groups[g].first;
+            size_t m = groups[g].second == 4 ? 2 : 1;
+            size_t dim = m * n;
+            std::vector<double> t(dim), h(dim * dim);
+            for (size_t a = 0; a < m; a = a + 1)
+            {
+                for (size_t b = 0; b < m; b = b + 1)
+                {
+                    const auto &v = kernels[first + a * m + b];
+                    for (size_t i = 0; i < n; i = i + 1)
+                    {
+                        for (size_t k = 0; k < n; k = k + 1)
+                        {
+                            h[(a * n + i) * dim + b * n + k] = f[i] * v[i * n + k] * f[k] * to_fm;
+                        }
+                    }
+                }
+                for (size_t i = 0; i < n; i = i + 1)
+                {
+                    t[a * n + i] = p[i] * p[i] / configs.mass_nucleon * to_fm;
+                    h[(a * n + i) * dim + a * n + i] += t[a * n + i];
+                }
+            }
+
+            auto results = evolve(t, h, dim, s_targets, st.tolerance, steps[g]);
+
+            // back to V(p', p) in MeV^-2, one n x n matrix per channel.
+            for (auto &r : results)
+            {
+                for (size_t a = 0; a < m; a = a + 1)
+                {
+                    for (size_t b = 0; b < m; b = b + 1)
+                    {
+                        std::vector<double> v(n * n);
+                        for (size_t i = 0; i < n; i = i + 1)
+                        {
+                            for (size_t k = 0; k < n; k = k + 1)
+                            {
+                                double value = r[(a * n + i) * dim + b * n + k] - (a == b && i == k ? t[a * n + i] : 0.0);
+                                v[i * n + k] = value / (to_fm * f[i] * f[k]);
+                            }
+                        }
+                        evolved[first + a * m + b].push_back(std::move(v));
+                    }
+                }
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        // write every lambda like a normal run.
+        for (size_t idx_lambda = 0; idx_lambda < st.lambdas.size(); idx_lambda = idx_lambda + 1)
+        {
+            NN::NN_configs evolved_configs = configs;
+            evolved_configs.result_name = evolved_name(configs.result_name, st.lambdas[idx_lambda]);
+            std::ostringstream oss_derivation;
+            oss_derivation << "srg " << std::fixed << std::setprecision(2) << st.lambdas[idx_lambda] << " fm^-1";
+            evolved_configs.derivation = oss_derivation.str();
+            kernel_output::write_mesh_and_partial_waves(evolved_configs);
+            kernel_output::kernel_writer writer(evolved_configs);
+            for (size_t idx = 0; idx < channels.size(); idx = idx + 1)
+            {
+                writer.add(idx, evolved[idx][idx_lambda]);
+            }
+            writer.print_compression();
+        }
+
+        std::cout.precision(4);
+        std::cout << "---- srg evolution of " << groups.size() << " channels to lambda =";
+        for (double lambda : st.lambdas)
+        {
+            std::cout << " " << lambda;
+        }
+        std::cout << " fm^-1, " << std::accumulate(steps.begin(), steps.end(), size_t(0)) << " steps in total\n"
+                  << "     mesh kernels: " << std::chrono::duration<double>(kernels_end - start).count() << " s, evolution: "
+                  << std::chrono::duration<double>(end - kernels_end).count() << " s" << std::endl;
+    }
+
+} // namespace srg
+
+#endif // SRG_HPP
@@ -0,0 +1,144 @@
+#pragma once
+#ifndef TPE_PROJECTION_HPP
+#define TPE_PROJECTION_HPP
+
+#include "interaction_part_pion_exchange.hpp"
+#include "lib_define.hpp"
+#include "ope_projection.hpp"
+
+// partial-wave projection of the two-pion exchange without angular quadrature, switched on by "tpe_projection = spectral".
+// with the yukawa expansion of configs (spectral_tables.hpp), every f-component is a polynomial in t = q^2 plus
+//     sum_n r_n / (mu_n^2 + q^2),
+// and each yukawa term is projected like the one-pion exchange in ope_projection.hpp, 2 sum_k a_k Q_k(z_n) / (2 p' p),
+// with the legendre coefficients a_k of the channel polynomials of f1, f2 and f6. the polynomial part is projected
+// exactly with the gauss-legendre rule of j + 6 points; it does not reach peripheral waves, so there the projection is
+// a sum of Q_k alone. the only approximation left is the spectral quadrature in mu, fixed once per run.
+namespace tpe_projection
+{
+    // f-vector index of the components f1, f2, f6 of the expansion.
+    constexpr size_t f_index[spectral_tables::expansion_component_number] = {0, 1, 5};
+
+    // highest l or l' the polynomial part reaches: f1 and f2 of degree d in t are polynomials of degree 2d in the
+    // momenta, f6 multiplies (sigma_1 q)(sigma_2 q) of degree 2.
+    int polynomial_reach(const spectral_tables::yukawa_expansion &ex)
+    {
+        int reach = -1;
+        for (const auto &order : ex.terms)
+        {
+            for (const auto &part : order)
+            {
+                for (int comp = 0; comp < spectral_tables::expansion_component_number; comp = comp + 1)
+                {
+                    const auto &poly = part[comp].polynomial;
+                    for (int k = int(poly.size()) - 1; k >= 0; k = k - 1)
+                    {
+                        if (poly[k] != 0.0)
+                        {
+                            reach = std::max(reach, 2 * k + (comp == spectral_tables::tensor_f6 ? 2 : 0));
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        return reach;
+    }
+
+    // projected two-pion exchange of one channel up to the chiral order of configs, the same terms as the angular
+    // integration of the two-pion-exchange terms of potential_pion_exchange, without normalization.
+    template <typename T>
+    T potential(const int &l_final, const int &l_initial, const int &s, const int &j, const int &tz, const T &p_final, const T &p_initial, const NN::NN_configs &configs)
+    {
+        const auto &ex = configs.two_pion_exchange_expansion;
+        constexpr int components = spectral_tables::expansion_component_number;
+        const size_t powers[] = {configs.n_reg_two_pion_exchange_nlo, configs.n_reg_two_pion_exchange_n2lo, configs.n_reg_two_pion_exchange_n3lo};
+        T isospin_factor = interaction_part_pion_exchange::get_isospin_factor(l_final, l_initial, s, j, tz);
+
+        // residues and polynomials of the channel, with the regulator of every order.
+        std::array<std::vector<T>, components> residue, polynomial;
+        for (int comp = 0; comp < components; comp = comp + 1)
+        {
+            residue[comp].assign(ex.mass.size(), T(0.0));
+        }
+        for (size_t order = 0; order < std::min<size_t>(configs.chiral_order_index, spectral_tables::expansion_order_number); order = order + 1)
+        {
+            T regulator = interaction_aPWD::regulator_function(p_initial, p_final, powers[order], configs);
+            for (int part = 0; part < spectral_tables::expansion_part_number; part = part + 1)
+            {
+                T factor = part == spectral_tables::isovector ? regulator * isospin_factor : regulator;
+                for (int comp = 0; comp < components; comp = comp + 1)
+                {
+                    const auto &sum = ex.terms[order][part][comp];
+                    for (size_t n = 0; n < sum.residue.size(); n = n + 1)
+                    {
+                        residue[comp][n] = residue[comp][n] + factor * T(sum.residue[n]);
+                    }
+                    if (polynomial[comp].size() < sum.polynomial.size())
+                    {
+                        polynomial[comp].resize(sum.polynomial.size(), T(0.0));
+                    }
+                    for (size_t k = 0; k < sum.polynomial.size(); k = k + 1)
+                    {
+                        polynomial[comp][k] = polynomial[comp][k] + factor * T(sum.polynomial[k]);
+                    }
+                }
+            }
+        }
+
+        // yukawa terms, the Q_k of one mass are shared by the three components.
+        std::array<std::vector<T>, components> a;
+        for (int comp = 0; comp < components; comp = comp + 1)
+        {
+            a[comp] = ope_projection::legendre_coefficients(l_final, l_initial, s, j, p_final, p_initial, int(f_index[comp]));
+        }
+        T two_pp = T(2.0) * p_final * p_initial;
+        T p2 = p_final * p_final + p_initial * p_initial;
+        std::vector<T> q;
+        std::vector<T> terms(ex.mass.size());
+        for (size_t n = 0; n < ex.mass.size(); n = n + 1)
+        {
+            T z = (p2 + T(ex.mass[n] * ex.mass[n])) / two_pp;
+            ope_projection::legendre_q(z, int(a[0].size()) - 1, q);
+            T term = T(0.0);
+            for (int comp = 0; comp < components; comp = comp + 1)
+            {
+                T sum = T(0.0);
+                for (size_t k = 0; k < q.size(); k = k + 1)
+                {
+                    sum = sum + a[comp][k] * q[k];
+                }
+                term = term + residue[comp][n] * sum;
+            }
+            terms[n] = term;
+        }
+        T projected = T(2.0) * basic_math::neumaier_sum(terms) / two_pp;
+
+        // polynomial part.
+        int reach = polynomial_reach(ex);
+        if (l_final <= reach && l_initial <= reach)
+        {
+            const auto &rule = basic_math::gauss_legendre_rule(j + 6);
+            std::vector<T> f(6, T(0.0));
+            for (size_t g = 0; g < rule.nodes.size(); g = g + 1)
+            {
+                T x = T(rule.nodes[g]);
+                T t = p2 - two_pp * x;
+                for (int comp = 0; comp < components; comp = comp + 1)
+                {
+                    // horner's scheme.
+                    T value = T(0.0);
+                    for (size_t k = polynomial[comp].size(); k-- > 0;)
+                    {
+                        value = value * t + polynomial[comp][k];
+                    }
+                    f[f_index[comp]] = value;
+                }
+                projected = projected + interaction_aPWD::potential_auto(l_final, l_initial, s, j, p_final, p_initial, x, f) * T(rule.weights[g]);
+            }
+        }
+        return projected;
+    }
+
+} // namespace tpe_projection
+
+#endif // TPE_PROJECTION_HPP
@@ -0,0 +1,241 @@
+// element-wise comparison of two NN-cms output directories.
+//
+// usage: kernel-diff.x <dir_a> <dir_b> [--max-ulp N] [--max-rel X] [--abs-floor X]
+//
+// every "kernel-*.bin" file of dir_a is mapped into memory together with the file of the same name
+// in dir_b and compared as arrays of doubles, or of floats for "*.f32.bin". the factors of "*.lowrank.bin"
+// are read with kernel_lowrank.hpp and the reconstructed matrices are compared. an element passes if it is
+// within max-ulp units in the last place of its type, or within max-rel relative to max(|a|, abs-floor
+// * peak of the file).
+// prints one line per file and exits with 1 if any file differs beyond the tolerances.
+
+#include "../src/kernel_lowrank.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+namespace kernel_diff
+{
+    // read-only memory mapping of a whole file.
+    class mapped_file
+    {
+    public:
+        mapped_file(const std::string &fname)
+        {
+            fd = open(fname.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                return;
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0)
+            {
+                return;
+            }
+            bytes = st.st_size;
+            if (bytes > 0)
+            {
+                void *p = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED)
+                {
+                    data = static_cast<const char *>(p);
+                    madvise(p, bytes, MADV_SEQUENTIAL);
+                }
+            }
+        }
+        ~mapped_file()
+        {
+            if (data != nullptr)
+            {
+                munmap(const_cast<char *>(data), bytes);
+            }
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+        bool good() const { return fd >= 0 && (data != nullptr || bytes == 0); }
+        size_t bytes_size() const { return bytes; }
+        template <typename V>
+        const V *values() const { return reinterpret_cast<const V *>(data); }
+
+    private:
+        int fd = -1;
+        size_t bytes = 0;
+        const char *data = nullptr;
+    };
+
+    // distance in units in the last place of the type "V" (double or float).
+    template <typename V>
+    uint64_t ulp_distance(V a, V b)
+    {
+        if (a == b)
+        {
+            return 0;
+        }
+        if (std::isnan(a) || std::isnan(b))
+        {
+            return UINT64_MAX;
+        }
+        using I = typename std::conditional<sizeof(V) == 8, int64_t, int32_t>::type;
+        I ia, ib;
+        std::memcpy(&ia, &a, sizeof(V));
+        std::memcpy(&ib, &b, sizeof(V));
+        int64_t sa = ia < 0 ? int64_t(std::numeric_limits<I>::min()) - ia : ia;
+        int64_t sb = ib < 0 ? int64_t(std::numeric_limits<I>::min()) - ib : ib;
+        if (sizeof(V) == 8)
+        {
+            // the signed distance of doubles can overflow int64_t, compute it unsigned.
+            return (sa > sb) ? static_cast<uint64_t>(sa) - static_cast<uint64_t>(sb) : static_cast<uint64_t>(sb) - static_cast<uint64_t>(sa);
+        }
+        return static_cast<uint64_t>(sa > sb ? sa - sb : sb - sa);
+    }
+
+    // result of the comparison of one file.
+    struct comparison
+    {
+        size_t failed = 0;
+        size_t worst = 0;
+        uint64_t worst_ulp = 0;
+        double worst_rel = 0.0;
+    };
+
+    // compare the "n" values of "a" and "b".
+    template <typename V>
+    comparison compare(const V *a, const V *b, size_t n, uint64_t max_ulp, double max_rel, double abs_floor)
+    {
+        comparison c;
+        double peak = 0.0;
+        for (size_t i = 0; i < n; i = i + 1)
+        {
+            peak = std::max(peak, std::fabs(double(a[i])));
+        }
+        double floor = abs_floor * peak;
+        for (size_t i = 0; i < n; i = i + 1)
+        {
+            uint64_t ulp = ulp_distance<V>(a[i], b[i]);
+            if (ulp == 0)
+            {
+                continue;
+            }
+            double rel = std::fabs(double(a[i]) - double(b[i])) / std::max(std::fabs(double(a[i])), floor);
+            if (ulp > max_ulp && !(rel <= max_rel))
+            {
+                c.failed = c.failed + 1;
+            }
+            if (rel > c.worst_rel || (rel == c.worst_rel && ulp > c.worst_ulp))
+            {
+                c.worst_rel = rel;
+                c.worst_ulp = ulp;
+                c.worst = i;
+            }
+        }
+        return c;
+    }
+
+} // namespace kernel_diff
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "usage: kernel-diff.x <dir_a> <dir_b> [--max-ulp N] [--max-rel X] [--abs-floor X]" << std::endl;
+        return 2;
+    }
+    std::string dir_a = argv[1];
+    std::string dir_b = argv[2];
+    uint64_t max_ulp = 64;
+    double max_rel = 1e-12;
+    double abs_floor = 1e-10;
+    for (int i = 3; i + 1 < argc; i = i + 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--max-ulp")
+        {
+            max_ulp = std::stoull(argv[i + 1]);
+        }
+        else if (arg == "--max-rel")
+        {
+            max_rel = std::stod(argv[i + 1]);
+        }
+        else if (arg == "--abs-floor")
+        {
+            abs_floor = std::stod(argv[i + 1]);
+        }
+        else
+        {
+            std::cerr << "unknown option: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    std::vector<std::string> names;
+    for (const auto &entry : std::filesystem::directory_iterator(dir_a))
+    {
+        auto name = entry.path().filename().string();
+        if (name.rfind("kernel-", 0) == 0 && entry.path().extension() == ".bin")
+        {
+            names.push_back(name);
+        }
+    }
+    std::sort(names.begin(), names.end());
+
+    size_t failed_files = 0;
+    for (const auto &name : names)
+    {
+        if (name.size() > 12 && name.compare(name.size() - 12, 12, ".lowrank.bin") == 0)
+        {
+            kernel_lowrank::factors la, lb;
+            auto error = kernel_lowrank::read(dir_a + "/" + name, la);
+            error = error.empty() ? kernel_lowrank::read(dir_b + "/" + name, lb) : error;
+            if (!error.empty() || la.dim != lb.dim)
+            {
+                std::cout << "FAIL " << name << ": " << (error.empty() ? "dimension mismatch" : error) << std::endl;
+                failed_files = failed_files + 1;
+                continue;
+            }
+            auto va = la.reconstruct(), vb = lb.reconstruct();
+            auto c = kernel_diff::compare(va.data(), vb.data(), va.size(), max_ulp, max_rel, abs_floor);
+            if (c.failed > 0)
+            {
+                failed_files = failed_files + 1;
+            }
+            std::cout << (c.failed == 0 ? "PASS " : "FAIL ") << name << ": failed " << c.failed << "/" << va.size() << std::scientific << std::setprecision(3) << ", max rel "
+                      << c.worst_rel << ", ulp " << c.worst_ulp << " at element " << c.worst << " (reconstructed, ranks " << la.rank << " and " << lb.rank << ")" << std::endl;
+            continue;
+        }
+        kernel_diff::mapped_file fa(dir_a + "/" + name);
+        kernel_diff::mapped_file fb(dir_b + "/" + name);
+        bool single = name.size() > 8 && name.compare(name.size() - 8, 8, ".f32.bin") == 0;
+        size_t value_bytes = single ? sizeof(float) : sizeof(double);
+        if (!fa.good() || !fb.good() || fa.bytes_size() != fb.bytes_size() || fa.bytes_size() % value_bytes != 0)
+        {
+            std::cout << "FAIL " << name << ": missing file or size mismatch" << std::endl;
+            failed_files = failed_files + 1;
+            continue;
+        }
+        size_t n = fa.bytes_size() / value_bytes;
+        auto c = single ? kernel_diff::compare(fa.values<float>(), fb.values<float>(), n, max_ulp, max_rel, abs_floor)
+                        : kernel_diff::compare(fa.values<double>(), fb.values<double>(), n, max_ulp, max_rel, abs_floor);
+        if (c.failed > 0)
+        {
+            failed_files = failed_files + 1;
+        }
+        std::cout << (c.failed == 0 ? "PASS " : "FAIL ") << name << ": failed " << c.failed << "/" << n << std::scientific << std::setprecision(3) << ", max rel " << c.worst_rel
+                  << ", ulp " << c.worst_ulp << " at element " << c.worst << std::endl;
+    }
+    std::cout << names.size() << " files compared, " << failed_files << " failing" << std::endl;
+    return failed_files == 0 ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+// publish, inspect and remove kernel sets in POSIX shared memory, see src/kernel_store.hpp.
+//
+// usage: kernel-shm.x publish <dir> <result_name> <shm_name>
+//        kernel-shm.x info <shm_name>
+//        kernel-shm.x unlink <shm_name>
+//
+// "publish" reads the momentum mesh, the partial-waves and the double "kernel-*.bin" files that NN-cms
+// wrote for result_name into dir, and publishes them like "shm_name" in the [output] section does.
+
+#include "../src/kernel_store.hpp"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace kernel_shm
+{
+    std::string tz_name(int tz)
+    {
+        return tz == -1 ? "pp" : (tz == 0 ? "np" : "nn");
+    }
+
+    // lines of a table file without the "#" comments.
+    std::vector<std::string> table_lines(const std::string &fname)
+    {
+        std::vector<std::string> lines;
+        std::ifstream fp(fname);
+        if (!fp.is_open())
+        {
+            std::cerr << "failed to open file: " << fname << std::endl;
+            exit(1);
+        }
+        std::string line;
+        while (std::getline(fp, line))
+        {
+            if (!line.empty() && line[0] != '#')
+            {
+                lines.push_back(line);
+            }
+        }
+        return lines;
+    }
+
+    int publish(const std::string &dir, const std::string &result_name, const std::string &shm_name)
+    {
+        std::string prefix = dir + (dir.back() == '/' ? "" : "/");
+
+        // momentum mesh: number of points, then points and weights.
+        auto mesh_lines = table_lines(prefix + result_name + "-momentum-mesh.txt");
+        size_t n = std::stoul(mesh_lines[0]);
+        std::vector<double> points, weights;
+        for (size_t i = 1; i <= n; i = i + 1)
+        {
+            std::istringstream iss(mesh_lines[i]);
+            double p, w;
+            iss >> p >> w;
+            points.push_back(p);
+            weights.push_back(w);
+        }
+
+        std::vector<std::vector<int>> channels;
+        std::vector<std::vector<double>> kernels;
+        for (const auto &line : table_lines(prefix + result_name + "-partial-waves.txt"))
+        {
+            std::istringstream iss(line);
+            std::vector<int> channel(5);
+            iss >> channel[0] >> channel[1] >> channel[2] >> channel[3] >> channel[4];
+            std::ostringstream oss;
+            oss << prefix << "kernel-" << result_name << "-" << channel[0] << "-" << channel[1] << "-" << channel[2] << "-" << channel[3] << "-" << tz_name(channel[4]) << ".bin";
+            std::ifstream fp(oss.str(), std::ios::binary);
+            std::vector<double> v(n * n);
+            if (!fp.read(reinterpret_cast<char *>(v.data()), n * n * sizeof(double)))
+            {
+                std::cerr << "failed to read " << n * n << " doubles from: " << oss.str() << std::endl;
+                return 1;
+            }
+            channels.push_back(channel);
+            kernels.push_back(v);
+        }
+
+        auto error = kernel_store::publish(shm_name, result_name, channels, points, weights, kernels);
+        if (!error.empty())
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        kernel_store::view published(shm_name);
+        std::cout << "published " << channels.size() << " channels of " << result_name << " in " << shm_name << ", generation " << published.info().generation << std::endl;
+        return 0;
+    }
+
+    int info(const std::string &shm_name)
+    {
+        kernel_store::view store(shm_name);
+        if (!store.good())
+        {
+            std::cerr << store.error() << std::endl;
+            return 1;
+        }
+        const auto &h = store.info();
+        std::cout << shm_name << ": " << h.result_name << ", version " << h.version << ", generation " << h.generation << ", " << h.total_bytes << " bytes, "
+                  << h.mesh_points_number << " mesh points, " << h.channel_number << " channels\n";
+        for (size_t i = 0; i < store.channel_number(); i = i + 1)
+        {
+            const auto &c = store.entry(i).channel;
+            std::cout << "  " << c[0] << "-" << c[1] << "-" << c[2] << "-" << c[3] << "-" << tz_name(c[4]) << "\n";
+        }
+        return 0;
+    }
+
+} // namespace kernel_shm
+
+int main(int argc, char **argv)
+{
+    std::string command = (argc > 1) ? argv[1] : "";
+    if (command == "publish" && argc == 5)
+    {
+        return kernel_shm::publish(argv[2], argv[3], argv[4]);
+    }
+    if (command == "info" && argc == 3)
+    {
+        return kernel_shm::info(argv[2]);
+    }
+    if (command == "unlink" && argc == 3)
+    {
+        if (!kernel_store::unlink(argv[2]))
+        {
+            std::cerr << "cannot unlink: " << argv[2] << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    std::cerr << "usage: kernel-shm.x publish <dir> <result_name> <shm_name>\n"
+              << "       kernel-shm.x info <shm_name>\n"
+              << "       kernel-shm.x unlink <shm_name>" << std::endl;
+    return 2;
+}